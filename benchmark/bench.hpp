@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <hc.hpp>
+
+// Minimal benchmark harness in the style of Google Benchmark.
+//
+//   bench::add("copy_async/1048576", [=](bench::state& s) {
+//     s.set_bytes(1048576);
+//     s.run([&]() { ...one iteration, waiting for it to finish... });
+//   });
+//   return bench::main(argc, argv);
+//
+// run() calls the body once to warm up, then in batches of growing size until at
+// least --min_time seconds were spent in timed batches, and records the mean time
+// per iteration.  Results go to stdout as a table and, with --json <file>, to a
+// Google Benchmark compatible JSON file, so runs on different runtime versions can
+// be diffed with the usual tools.  --filter <substring> runs only matching cases.
+
+namespace bench {
+
+struct result {
+  std::string name;
+  std::string device;       // "gpu", or "cpu" when the case ran its host fallback
+  long long iterations;
+  double seconds;           // mean per iteration
+  double bytes;             // per iteration, 0 if not a bandwidth case
+  double items;             // per iteration, 0 if not a throughput case
+};
+
+class state {
+public:
+  state(const std::string& name, const std::string& device, double min_time)
+    : _min_time(min_time) {
+    _result.name = name;
+    _result.device = device;
+    _result.iterations = 0;
+    _result.seconds = _result.bytes = _result.items = 0.0;
+  }
+
+  void set_bytes(double bytes) { _result.bytes = bytes; }
+  void set_items(double items) { _result.items = items; }
+  void set_device(const std::string& device) { _result.device = device; }
+
+  template <typename F>
+  void run(F body) {
+    body();   // warm up
+
+    long long total = 0;
+    double elapsed = 0.0;
+    for (long long batch = 1; elapsed < _min_time; batch *= 2) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (long long i = 0; i < batch; i++) {
+        body();
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      elapsed += std::chrono::duration<double>(end - start).count();
+      total += batch;
+    }
+    _result.iterations = total;
+    _result.seconds = elapsed / total;
+  }
+
+  const result& get() const { return _result; }
+
+private:
+  double _min_time;
+  result _result;
+};
+
+struct entry {
+  std::string name;
+  std::function<void(state&)> fn;
+};
+
+inline std::vector<entry>& registry() {
+  static std::vector<entry> entries;
+  return entries;
+}
+
+inline void add(const std::string& name, std::function<void(state&)> fn) {
+  registry().push_back({ name, fn });
+}
+
+// the accelerator the suite runs on, and whether it can run kernels
+inline bool have_gpu() {
+  static const bool gpu = hc::accelerator().is_hsa_accelerator();
+  return gpu;
+}
+
+inline std::string narrow(const std::wstring& w) {
+  std::string s;
+  for (wchar_t c : w) s += (c > 127) ? '?' : char(c);
+  return s;
+}
+
+inline void write_json(FILE* out, const std::vector<result>& results) {
+  char date[64];
+  time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(out, "{\n  \"context\": {\n");
+  fprintf(out, "    \"date\": \"%s\",\n", date);
+  fprintf(out, "    \"device\": \"%s\",\n", narrow(hc::accelerator().get_description()).c_str());
+  fprintf(out, "    \"device_path\": \"%s\",\n", narrow(hc::accelerator().get_device_path()).c_str());
+  fprintf(out, "    \"gpu\": %s\n", have_gpu() ? "true" : "false");
+  fprintf(out, "  },\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const result& r = results[i];
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"name\": \"%s\",\n", r.name.c_str());
+    fprintf(out, "      \"device\": \"%s\",\n", r.device.c_str());
+    fprintf(out, "      \"iterations\": %lld,\n", r.iterations);
+    fprintf(out, "      \"real_time\": %.3f,\n", r.seconds * 1.0e9);
+    if (r.bytes > 0.0)
+      fprintf(out, "      \"bytes_per_second\": %.6e,\n", r.bytes / r.seconds);
+    if (r.items > 0.0)
+      fprintf(out, "      \"items_per_second\": %.6e,\n", r.items / r.seconds);
+    fprintf(out, "      \"time_unit\": \"ns\"\n");
+    fprintf(out, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+inline int main(int argc, char* argv[]) {
+  const char* json = NULL;
+  const char* filter = NULL;
+  double min_time = 0.5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json = argv[++i];
+    else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+    else if (strcmp(argv[i], "--min_time") == 0 && i + 1 < argc) min_time = atof(argv[++i]);
+    else {
+      printf("usage: %s [--json file] [--filter substring] [--min_time seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  printf("running on %s (%s)\n", narrow(hc::accelerator().get_description()).c_str()
+         , have_gpu() ? "gpu" : "cpu fallback");
+  printf("%-40s %-4s %12s %14s %14s\n", "benchmark", "dev", "iterations", "time (us)", "rate");
+
+  std::vector<result> results;
+  for (auto& e : registry()) {
+    if (filter != NULL && e.name.find(filter) == std::string::npos) continue;
+
+    state s(e.name, have_gpu() ? "gpu" : "cpu", min_time);
+    e.fn(s);
+    const result& r = s.get();
+    if (r.iterations == 0) continue;   // the case did not apply to this device
+    results.push_back(r);
+
+    char rate[32] = "";
+    if (r.bytes > 0.0) snprintf(rate, sizeof(rate), "%.2f GB/s", r.bytes / r.seconds / 1.0e9);
+    else if (r.items > 0.0) snprintf(rate, sizeof(rate), "%.2f G/s", r.items / r.seconds / 1.0e9);
+    printf("%-40s %-4s %12lld %14.3f %14s\n", r.name.c_str(), r.device.c_str(), r.iterations
+           , r.seconds * 1.0e6, rate);
+  }
+
+  if (json != NULL) {
+    FILE* out = fopen(json, "w");
+    if (out == NULL) {
+      printf("can't open %s\n", json);
+      return 1;
+    }
+    write_json(out, results);
+    fclose(out);
+  }
+  return 0;
+}
+
+} // namespace bench
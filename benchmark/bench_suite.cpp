@@ -0,0 +1,307 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <hc.hpp>
+#include "hc_am.hpp"
+#include "host_simd.hpp"
+#include "reduce.hpp"
+#include "gemm.hpp"
+#include "wave_rotate_gemm.hpp"
+#include "radix_sort.hpp"
+#include "algorithm.hpp"
+#include "bench.hpp"
+
+// Launch latency and throughput of the samples' building blocks.
+//
+//   bench_suite [--json results.json] [--filter reduce/] [--min_time 0.5]
+//
+// Without an HSA accelerator every case that has a host implementation runs that
+// instead and is reported with device "cpu"; GPU-only variants are skipped.
+
+namespace {
+
+std::vector<float> random_floats(size_t n) {
+  std::vector<float> v(n);
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::generate(v.begin(), v.end(), [&]() { return distribution(random_gen); });
+  return v;
+}
+
+//---
+// Launch latency
+
+void launch_latency(bench::state& s) {
+  if (bench::have_gpu()) {
+    hc::accelerator_view view = hc::accelerator().get_default_view();
+    s.run([&]() {
+      hc::parallel_for_each(view, hc::extent<1>(1), [](hc::index<1>) [[hc]] {}).wait();
+    });
+  }
+  else {
+    // the host equivalent of a launch: hand work to another thread and wait for it
+    s.run([]() { std::thread([]() {}).join(); });
+  }
+}
+
+//---
+// Copies, host to device
+
+void copy_async_bandwidth(bench::state& s, size_t bytes) {
+  hc::accelerator_view view = hc::accelerator().get_default_view();
+  std::vector<char> host(bytes, 1);
+  void* dev = hc::am_alloc(bytes, AM_EXPLICIT_SYNC, view);
+  if (dev == NULL) return;
+
+  s.set_bytes(bytes);
+  s.run([&]() {
+    hc::completion_future f;
+    if (hc::am_copy_async(dev, host.data(), bytes, view, &f) == AM_SUCCESS)
+      f.wait();
+  });
+  hc::am_free(dev);
+}
+
+void am_copy_bandwidth(bench::state& s, size_t bytes) {
+  hc::accelerator_view view = hc::accelerator().get_default_view();
+  std::vector<char> host(bytes, 1);
+  void* dev = hc::am_alloc(bytes, AM_EXPLICIT_SYNC, view);
+  if (dev == NULL) return;
+
+  s.set_bytes(bytes);
+  s.run([&]() { hc::am_copy(dev, host.data(), bytes); });
+  hc::am_free(dev);
+}
+
+//---
+// Reductions
+
+template <typename Strategy, typename Combine = reduction::two_pass, typename Load = reduction::load_pair>
+void reduce_throughput(bench::state& s, int num) {
+  bool host = std::is_same<Strategy, reduction::host>::value;
+  if (bench::have_gpu() == host) return;
+
+  std::vector<float> data = random_floats(num);
+  hc::array_view<const float,1> av_data(num, data);
+
+  s.set_items(num);
+  s.set_bytes(double(num) * sizeof(float));
+  s.run([&]() {
+    reduction::reduce<float, reduction::sum<float>, Strategy, reduction::WAVEFRONT, Combine, Load>(av_data);
+  });
+}
+
+//---
+// Matrix multiply, square n x n
+
+enum matmul_kind { NAIVE, WAVE_ROTATE, BLOCKED, HOST };
+
+void matmul_throughput(bench::state& s, matmul_kind kind, int n) {
+  constexpr int COLS = 4;
+  // on the CPU naive and wave_rotate run as host emulations, blocked has none
+  if ((kind == BLOCKED && !bench::have_gpu()) || (kind == HOST && bench::have_gpu())) return;
+
+  std::vector<float> matA = random_floats(n * n);
+  std::vector<float> matB = random_floats(n * n);
+  std::vector<float> matC(n * n);
+  hc::array_view<const float,2> av_mat_A(n, n, matA);
+  hc::array_view<const float,2> av_mat_B(n, n, matB);
+  hc::array_view<float,2> av_mat_C(n, n, matC);
+
+  s.set_items(2.0 * n * n * n);   // flops
+  if (!bench::have_gpu()) {
+    s.run([&]() {
+      switch (kind) {
+        case NAIVE:
+          for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) {
+              float p = 0.0f;
+              for (int k = 0; k < n; k++)
+                p += matA[i * n + k] * matB[k * n + j];
+              matC[i * n + j] = p;
+            }
+          break;
+        case WAVE_ROTATE:
+          wave_rotate::wave_rotate_host<float, COLS>(matA, matB, matC, n, n, n);
+          break;
+        default:
+          host_simd::gemm(n, n, n, matA.data(), matB.data(), matC.data());
+          break;
+      }
+    });
+    return;
+  }
+
+  s.run([&]() {
+    switch (kind) {
+      case NAIVE:       gemm::naive<float>(av_mat_A, av_mat_B, av_mat_C).wait(); break;
+      case WAVE_ROTATE: wave::dispatch(hc::accelerator(), [&](auto width) {
+          wave_rotate::wave_rotate<float, COLS, decltype(width)::value>(av_mat_A, av_mat_B, av_mat_C, 4).wait();
+        });
+        break;
+      default:          gemm::blocked<float>(av_mat_A, av_mat_B, av_mat_C).wait(); break;
+    }
+  });
+}
+
+//---
+// Sorting 32-bit keys: radix sort against std::sort and pstl::sort
+
+enum sort_kind { RADIX, STD, PSTL };
+
+void sort_throughput(bench::state& s, sort_kind kind, int num) {
+  if (kind == RADIX && !bench::have_gpu()) return;
+
+  std::vector<uint32_t> keys(num);
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<uint32_t> distribution;
+  std::generate(keys.begin(), keys.end(), [&]() { return distribution(random_gen); });
+  std::vector<uint32_t> work(num);
+
+  s.set_items(num);   // keys
+
+  if (kind == STD) {
+    s.set_device("cpu");
+    s.run([&]() {
+      work = keys;
+      std::sort(work.begin(), work.end());
+    });
+  }
+  else if (kind == RADIX) {
+    hc::array_view<uint32_t,1> av_keys(num, work);
+    s.run([&]() {
+      hc::copy(keys.begin(), keys.end(), av_keys);
+      radix::sort(av_keys);
+      av_keys.synchronize();
+    });
+  }
+  else if (bench::have_gpu()) {
+    // pstl::sort runs on the device when handed am_alloc'd memory
+    hc::accelerator_view view = hc::accelerator().get_default_view();
+    uint32_t* dev = static_cast<uint32_t*>(hc::am_alloc(num * sizeof(uint32_t), AM_EXPLICIT_SYNC, view));
+    if (dev == NULL) return;
+    s.run([&]() {
+      hc::am_copy(dev, keys.data(), num * sizeof(uint32_t));
+      pstl::sort(pstl::par, dev, dev + num);
+    });
+    hc::am_free(dev);
+  }
+  else {
+    s.run([&]() {
+      work = keys;
+      pstl::sort(pstl::par, work.begin(), work.end());
+    });
+  }
+}
+
+//---
+// saxpy split over several accelerator_views (or host threads)
+
+void saxpy_scaling(bench::state& s, int numViews) {
+  constexpr int N = 1024 * 1024 * 64;
+  constexpr float a = 100.0f;
+
+  std::vector<float> host_x = random_floats(N);
+  std::vector<float> host_y = random_floats(N);
+  const int perView = N / numViews;
+
+  s.set_items(N);
+  s.set_bytes(3.0 * N * sizeof(float));
+
+  if (!bench::have_gpu()) {
+    s.run([&]() {
+      std::vector<std::thread> threads;
+      for (int v = 0; v < numViews; v++) {
+        // one thread per slice, so the SIMD kernel must not split it further
+        threads.push_back(std::thread([&, v]() {
+          host_simd::saxpy(perView, a, host_x.data() + v * perView, host_y.data() + v * perView, 1);
+        }));
+      }
+      for (auto& t : threads) t.join();
+    });
+    return;
+  }
+
+  // views are spread round robin over all HSA accelerators
+  std::vector<hc::accelerator> accelerators;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (acc.is_hsa_accelerator()) accelerators.push_back(acc);
+  }
+
+  std::vector<hc::accelerator_view> views;
+  std::vector<hc::array_view<const float,1>> x_views;
+  std::vector<hc::array_view<float,1>> y_views;
+  for (int v = 0; v < numViews; v++) {
+    views.push_back(accelerators[v % accelerators.size()].create_view());
+    x_views.push_back(hc::array_view<const float,1>(perView, host_x.data() + v * perView));
+    y_views.push_back(hc::array_view<float,1>(perView, host_y.data() + v * perView));
+  }
+
+  s.run([&]() {
+    std::vector<hc::completion_future> futures;
+    for (int v = 0; v < numViews; v++) {
+      auto x_av = x_views[v];
+      auto y_av = y_views[v];
+      futures.push_back(hc::parallel_for_each(views[v], y_av.get_extent()
+                                              , [=](hc::index<1> i) [[hc]] {
+        y_av[i] = a * x_av[i] + y_av[i];
+      }));
+    }
+    for (auto& f : futures) f.wait();
+  });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+
+  bench::add("launch/empty_kernel", launch_latency);
+
+  for (size_t bytes = 4096; bytes <= 256 * 1024 * 1024; bytes *= 8) {
+    bench::add("copy_async/" + std::to_string(bytes), [=](bench::state& s) { copy_async_bandwidth(s, bytes); });
+  }
+  for (size_t bytes = 4096; bytes <= 256 * 1024 * 1024; bytes *= 8) {
+    bench::add("am_copy/" + std::to_string(bytes), [=](bench::state& s) { am_copy_bandwidth(s, bytes); });
+  }
+
+  for (int num : { 1024 * 1024, 1024 * 1024 * 32 }) {
+    const std::string n = "/" + std::to_string(num);
+    using namespace reduction;
+    bench::add("reduce/tile_static_tree" + n, [=](bench::state& s) { reduce_throughput<tile_static_tree>(s, num); });
+    bench::add("reduce/dynamic_group_mem" + n, [=](bench::state& s) { reduce_throughput<dynamic_group_mem>(s, num); });
+    bench::add("reduce/shuffle" + n, [=](bench::state& s) { reduce_throughput<shuffle>(s, num); });
+    bench::add("reduce/permute" + n, [=](bench::state& s) { reduce_throughput<permute>(s, num); });
+    bench::add("reduce/bpermute" + n, [=](bench::state& s) { reduce_throughput<bpermute>(s, num); });
+    bench::add("reduce/shuffle_atomic" + n, [=](bench::state& s) { reduce_throughput<shuffle, atomic>(s, num); });
+    bench::add("reduce/shuffle_grid_stride" + n, [=](bench::state& s) {
+      reduce_throughput<shuffle, two_pass, grid_stride>(s, num);
+    });
+    bench::add("reduce/host" + n, [=](bench::state& s) { reduce_throughput<host>(s, num); });
+  }
+
+  for (int n : { 256, 1024 }) {
+    const std::string size = "/" + std::to_string(n);
+    bench::add("matmul/naive" + size, [=](bench::state& s) { matmul_throughput(s, NAIVE, n); });
+    bench::add("matmul/wave_rotate" + size, [=](bench::state& s) { matmul_throughput(s, WAVE_ROTATE, n); });
+    bench::add("matmul/blocked" + size, [=](bench::state& s) { matmul_throughput(s, BLOCKED, n); });
+    bench::add("matmul/host" + size, [=](bench::state& s) { matmul_throughput(s, HOST, n); });
+  }
+
+  for (int num : { 1024 * 1024, 1024 * 1024 * 16 }) {
+    const std::string n = "/" + std::to_string(num);
+    bench::add("sort/radix" + n, [=](bench::state& s) { sort_throughput(s, RADIX, num); });
+    bench::add("sort/std" + n, [=](bench::state& s) { sort_throughput(s, STD, num); });
+    bench::add("sort/pstl" + n, [=](bench::state& s) { sort_throughput(s, PSTL, num); });
+  }
+
+  for (int views : { 1, 2, 4, 8 }) {
+    bench::add("saxpy/views:" + std::to_string(views), [=](bench::state& s) { saxpy_scaling(s, views); });
+  }
+
+  return bench::main(argc, argv);
+}
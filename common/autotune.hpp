@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <unistd.h>
+#include <hc.hpp>
+
+// Tile configuration autotuner.
+//
+//   autotune::tuner t("reduce_dynamic_group_mem", acc, autotune::shape_bucket(num));
+//   int tileSize = t.select({64, 128, 256, 512}, [&](int candidate) { ...run and wait... });
+//
+// select() times every candidate on the first call for a (kernel, device, shape bucket)
+// key, stores the fastest one in the cache file and returns it.  Later runs find the
+// key in the cache and return the stored value without running anything.
+//
+// The cache is a text file, one "kernel device bucket value" entry per line, with
+// whitespace inside each field replaced by '_'.  The device is the accelerator's
+// description, so a cache can be shared between machines with the same model.  It lives
+// in $AUTOTUNE_CACHE, or in ~/.autotune_cache if that is not set.
+
+namespace autotune {
+
+// Problem sizes within a factor of 2 of each other share a bucket.
+inline std::string shape_bucket(long long n) {
+  int b = 0;
+  while ((1LL << b) < n) b++;
+  return std::to_string(b);
+}
+
+inline std::string shape_bucket(long long m, long long n, long long k) {
+  return shape_bucket(m) + "x" + shape_bucket(n) + "x" + shape_bucket(k);
+}
+
+inline std::string cache_path() {
+  const char* path = getenv("AUTOTUNE_CACHE");
+  if (path != NULL) return path;
+  const char* home = getenv("HOME");
+  return std::string(home != NULL ? home : ".") + "/.autotune_cache";
+}
+
+// s as one token of the cache file: whitespace and non-ASCII become '_'
+inline std::string token(const std::wstring& s) {
+  std::string t;
+  for (wchar_t c : s) {
+    t += (c == L' ' || c == L'\t' || c == L'\n' || c == L'\r' || c > 127) ? '_' : char(c);
+  }
+  return t.empty() ? "unknown" : t;
+}
+
+inline std::string token(const std::string& s) {
+  return token(std::wstring(s.begin(), s.end()));
+}
+
+// The device model rather than its path: the path names a slot, which changes
+// between machines and when devices are enumerated in a different order.
+inline std::string device_name(const hc::accelerator& acc) {
+  return token(acc.get_description());
+}
+
+class tuner {
+public:
+  tuner(const std::string& kernel, const hc::accelerator& acc, const std::string& shape
+        , int iterations = 5)
+    : _key(token(kernel) + " " + device_name(acc) + " " + token(shape)), _iterations(iterations) {}
+
+  // Return the best candidate, measuring if the cache has no entry for this key.
+  // run(candidate) must launch the kernel with that configuration and wait for it.
+  template <typename F>
+  int select(const std::vector<int>& candidates, F run) {
+    if (candidates.empty()) {
+      fprintf(stderr, "autotune: no candidates for %s\n", _key.c_str());
+      abort();
+    }
+    std::map<std::string, int> cache = load();
+    auto cached = cache.find(_key);
+    if (cached != cache.end()) {
+      return cached->second;
+    }
+
+    int best = candidates.front();
+    double bestTime = 0.0;
+    for (int c : candidates) {
+      run(c);   // warm up
+
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < _iterations; i++) {
+        run(c);
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      double t = std::chrono::duration<double>(end - start).count() / _iterations;
+
+      if (c == candidates.front() || t < bestTime) {
+        best = c;
+        bestTime = t;
+      }
+    }
+
+    // reload, another process may have stored entries while we were measuring
+    cache = load();
+    cache[_key] = best;
+    store(cache);
+    return best;
+  }
+
+private:
+  std::map<std::string, int> load() const {
+    std::map<std::string, int> cache;
+    std::ifstream in(cache_path());
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string kernel, device, shape;
+      int value;
+      if (fields >> kernel >> device >> shape >> value) {
+        cache[kernel + " " + device + " " + shape] = value;
+      }
+    }
+    return cache;
+  }
+
+  // Write a temporary file next to the cache and rename it over the cache, so a
+  // concurrent reader sees either the old or the new file, never a partial one.
+  void store(const std::map<std::string, int>& cache) const {
+    std::string path = cache_path();
+    std::string tmp = path + ".tmp." + std::to_string(getpid());
+    {
+      std::ofstream out(tmp, std::ios::trunc);
+      for (auto& e : cache) {
+        out << e.first << " " << e.second << "\n";
+      }
+      out.flush();
+      if (!out) {
+        printf("autotune: can't write %s\n", tmp.c_str());
+        remove(tmp.c_str());
+        return;
+      }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+      printf("autotune: can't replace %s\n", path.c_str());
+      remove(tmp.c_str());
+    }
+  }
+
+  std::string _key;
+  int _iterations;
+};
+
+} // namespace autotune
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <immintrin.h>
+
+// Host backend for saxpy and GEMM, used when there is no HSA accelerator.
+//
+// The float kernels come in AVX-512, AVX2+FMA and scalar versions; the widest one
+// the CPU supports is picked at run time, so one binary runs everywhere.  Other
+// element types use the scalar version.  Work is split over a pool of threads, one per
+// hardware thread, started on first use and kept for the life of the process:
+// starting and joining threads costs tens of microseconds, which would be most of the
+// time of a small GEMM or saxpy slice.  Every entry point takes a thread count, 0 for
+// all of them; callers that already split the work over their own threads pass 1.
+//
+// GEMM is C = A * B, row-major, A MxK, B KxN.  Each call of the micro-kernel keeps a
+// ROWS x (2 vectors) block of C in registers while it walks a KC long slice of K,
+// doing ROWS FMAs for every vector of B it loads.
+
+namespace host_simd {
+
+enum isa { SCALAR, AVX2, AVX512 };
+
+inline isa detect() {
+  static const isa best = __builtin_cpu_supports("avx512f") ? AVX512
+                        : (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? AVX2
+                        : SCALAR;
+  return best;
+}
+
+inline const char* isa_name(isa i) {
+  return (i == AVX512) ? "avx512" : (i == AVX2) ? "avx2" : "scalar";
+}
+
+// Persistent worker threads.  run(n, f) calls f(0) ... f(n - 1) on the workers and the
+// calling thread and returns when all are done.  One run at a time uses the workers;
+// a run started while another is in flight, from another thread or from inside f,
+// executes on its calling thread alone.
+class thread_pool {
+public:
+  static thread_pool& instance() {
+    static thread_pool pool;
+    return pool;
+  }
+
+  // the workers plus the calling thread
+  int size() const { return int(_workers.size()) + 1; }
+
+  template <typename F>
+  void run(int n, F f) {
+    bool idle = false;
+    if (_workers.empty() || !_busy.compare_exchange_strong(idle, true)) {
+      for (int t = 0; t < n; t++)
+        f(t);
+      return;
+    }
+
+    job j;
+    j.f = f;
+    j.n = n;
+    {
+      std::lock_guard<std::mutex> l(_lock);
+      _job = &j;
+      _generation++;
+    }
+    _start.notify_all();
+
+    int finished = drain(j);
+    std::unique_lock<std::mutex> l(_lock);
+    j.finished += finished;
+    _done.wait(l, [&]() { return j.finished == j.n && j.users == 0; });
+    _job = NULL;
+    _busy = false;
+  }
+
+private:
+  struct job {
+    std::function<void (int)> f;
+    int n = 0;
+    std::atomic<int> next{0};
+    int finished = 0;         // guarded by _lock
+    int users = 0;            // workers inside drain(), guarded by _lock
+  };
+
+  thread_pool() {
+    int workers = int(std::max(1u, std::thread::hardware_concurrency())) - 1;
+    for (int w = 0; w < workers; w++)
+      _workers.push_back(std::thread([this]() { work(); }));
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> l(_lock);
+      _stop = true;
+    }
+    _start.notify_all();
+    for (auto& w : _workers)
+      w.join();
+  }
+
+  // run tasks of j until none are left, return how many
+  static int drain(job& j) {
+    int count = 0;
+    for (int t = j.next++; t < j.n; t = j.next++) {
+      j.f(t);
+      count++;
+    }
+    return count;
+  }
+
+  void work() {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> l(_lock);
+    while (true) {
+      _start.wait(l, [&]() { return _stop || (_job != NULL && _generation != seen); });
+      if (_stop)
+        return;
+      seen = _generation;
+      job& j = *_job;
+      j.users++;
+      l.unlock();
+      int finished = drain(j);
+      l.lock();
+      j.finished += finished;
+      j.users--;
+      if (j.finished == j.n && j.users == 0)
+        _done.notify_all();
+    }
+  }
+
+  std::vector<std::thread> _workers;
+  std::atomic<bool> _busy{false};   // set by the run using the workers
+  std::mutex _lock;
+  std::condition_variable _start;
+  std::condition_variable _done;
+  job* _job = NULL;
+  unsigned _generation = 0;
+  bool _stop = false;
+};
+
+// run f(begin, end) over [0, n) split in chunks of `grain`, one chunk range per thread;
+// threads == 0 uses all of the pool's
+template <typename F>
+void parallel_range(int n, int grain, F f, int threads = 0) {
+  if (threads <= 0)
+    threads = thread_pool::instance().size();
+  int chunks = (n + grain - 1) / grain;
+  threads = std::min(threads, chunks);
+  if (threads <= 1) {
+    f(0, n);
+    return;
+  }
+
+  thread_pool::instance().run(threads, [&](int t) {
+    int begin = std::min(n, (chunks * t / threads) * grain);
+    int end = std::min(n, (chunks * (t + 1) / threads) * grain);
+    f(begin, end);
+  });
+}
+
+
+//---
+// saxpy, y = a * x + y
+
+namespace detail {
+
+template <typename T>
+void axpy_scalar(int begin, int end, T a, const T* x, T* y) {
+  for (int i = begin; i < end; i++)
+    y[i] = a * x[i] + y[i];
+}
+
+__attribute__((target("avx2,fma")))
+inline void saxpy_avx2(int begin, int end, float a, const float* x, float* y) {
+  __m256 va = _mm256_set1_ps(a);
+  int i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 vy = _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i));
+    _mm256_storeu_ps(y + i, vy);
+  }
+  axpy_scalar(i, end, a, x, y);
+}
+
+__attribute__((target("avx512f")))
+inline void saxpy_avx512(int begin, int end, float a, const float* x, float* y) {
+  __m512 va = _mm512_set1_ps(a);
+  int i = begin;
+  for (; i + 16 <= end; i += 16) {
+    __m512 vy = _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i));
+    _mm512_storeu_ps(y + i, vy);
+  }
+  axpy_scalar(i, end, a, x, y);
+}
+
+} // namespace detail
+
+inline void saxpy(int n, float a, const float* x, float* y, int threads = 0) {
+  const isa i = detect();
+  parallel_range(n, 1 << 16, [=](int begin, int end) {
+    switch (i) {
+      case AVX512: detail::saxpy_avx512(begin, end, a, x, y); break;
+      case AVX2:   detail::saxpy_avx2(begin, end, a, x, y);   break;
+      default:     detail::axpy_scalar(begin, end, a, x, y);  break;
+    }
+  }, threads);
+}
+
+template <typename T>
+void axpy(int n, T a, const T* x, T* y, int threads = 0) {
+  parallel_range(n, 1 << 16, [=](int begin, int end) {
+    detail::axpy_scalar(begin, end, a, x, y);
+  }, threads);
+}
+
+
+//---
+// GEMM
+
+constexpr int ROWS = 4;       // rows of C per micro-kernel call
+constexpr int KC = 256;       // slice of K kept hot in cache
+
+namespace detail {
+
+// C[row0..row1) += A[row0..row1, k0..k1) * B[k0..k1, :], any element type
+template <typename T>
+void gemm_rows_scalar(int row0, int row1, int k0, int k1, int N, int K
+                      , const T* A, const T* B, T* C) {
+  for (int r = row0; r < row1; r++) {
+    for (int k = k0; k < k1; k++) {
+      T a = A[r * K + k];
+      for (int j = 0; j < N; j++)
+        C[r * N + j] += a * B[k * N + j];
+    }
+  }
+}
+
+__attribute__((target("avx2,fma")))
+inline void sgemm_rows_avx2(int row0, int row1, int k0, int k1, int N, int K
+                            , const float* A, const float* B, float* C) {
+  int r = row0;
+  for (; r + ROWS <= row1; r += ROWS) {
+    int j = 0;
+    for (; j + 16 <= N; j += 16) {
+      __m256 c[ROWS][2];
+      for (int i = 0; i < ROWS; i++) {
+        c[i][0] = _mm256_loadu_ps(C + (r + i) * N + j);
+        c[i][1] = _mm256_loadu_ps(C + (r + i) * N + j + 8);
+      }
+      for (int k = k0; k < k1; k++) {
+        __m256 b0 = _mm256_loadu_ps(B + k * N + j);
+        __m256 b1 = _mm256_loadu_ps(B + k * N + j + 8);
+        for (int i = 0; i < ROWS; i++) {
+          __m256 a = _mm256_broadcast_ss(A + (r + i) * K + k);
+          c[i][0] = _mm256_fmadd_ps(a, b0, c[i][0]);
+          c[i][1] = _mm256_fmadd_ps(a, b1, c[i][1]);
+        }
+      }
+      for (int i = 0; i < ROWS; i++) {
+        _mm256_storeu_ps(C + (r + i) * N + j, c[i][0]);
+        _mm256_storeu_ps(C + (r + i) * N + j + 8, c[i][1]);
+      }
+    }
+    // remaining columns
+    for (int i = 0; i < ROWS; i++)
+      for (int k = k0; k < k1; k++)
+        for (int jj = j; jj < N; jj++)
+          C[(r + i) * N + jj] += A[(r + i) * K + k] * B[k * N + jj];
+  }
+  gemm_rows_scalar(r, row1, k0, k1, N, K, A, B, C);
+}
+
+__attribute__((target("avx512f")))
+inline void sgemm_rows_avx512(int row0, int row1, int k0, int k1, int N, int K
+                              , const float* A, const float* B, float* C) {
+  int r = row0;
+  for (; r + ROWS <= row1; r += ROWS) {
+    int j = 0;
+    for (; j + 32 <= N; j += 32) {
+      __m512 c[ROWS][2];
+      for (int i = 0; i < ROWS; i++) {
+        c[i][0] = _mm512_loadu_ps(C + (r + i) * N + j);
+        c[i][1] = _mm512_loadu_ps(C + (r + i) * N + j + 16);
+      }
+      for (int k = k0; k < k1; k++) {
+        __m512 b0 = _mm512_loadu_ps(B + k * N + j);
+        __m512 b1 = _mm512_loadu_ps(B + k * N + j + 16);
+        for (int i = 0; i < ROWS; i++) {
+          __m512 a = _mm512_set1_ps(A[(r + i) * K + k]);
+          c[i][0] = _mm512_fmadd_ps(a, b0, c[i][0]);
+          c[i][1] = _mm512_fmadd_ps(a, b1, c[i][1]);
+        }
+      }
+      for (int i = 0; i < ROWS; i++) {
+        _mm512_storeu_ps(C + (r + i) * N + j, c[i][0]);
+        _mm512_storeu_ps(C + (r + i) * N + j + 16, c[i][1]);
+      }
+    }
+    // remaining columns
+    for (int i = 0; i < ROWS; i++)
+      for (int k = k0; k < k1; k++)
+        for (int jj = j; jj < N; jj++)
+          C[(r + i) * N + jj] += A[(r + i) * K + k] * B[k * N + jj];
+  }
+  gemm_rows_scalar(r, row1, k0, k1, N, K, A, B, C);
+}
+
+template <typename T>
+void gemm_rows(isa, int row0, int row1, int k0, int k1, int N, int K
+               , const T* A, const T* B, T* C) {
+  gemm_rows_scalar(row0, row1, k0, k1, N, K, A, B, C);
+}
+
+inline void gemm_rows(isa i, int row0, int row1, int k0, int k1, int N, int K
+                      , const float* A, const float* B, float* C) {
+  switch (i) {
+    case AVX512: sgemm_rows_avx512(row0, row1, k0, k1, N, K, A, B, C); break;
+    case AVX2:   sgemm_rows_avx2(row0, row1, k0, k1, N, K, A, B, C);   break;
+    default:     gemm_rows_scalar(row0, row1, k0, k1, N, K, A, B, C);  break;
+  }
+}
+
+} // namespace detail
+
+template <typename T>
+void gemm(int M, int N, int K, const T* A, const T* B, T* C, int threads = 0) {
+  const isa i = detect();
+  parallel_range(M, ROWS, [=](int row0, int row1) {
+    std::fill(C + row0 * N, C + row1 * N, T(0));
+    for (int k0 = 0; k0 < K; k0 += KC) {
+      detail::gemm_rows(i, row0, row1, k0, std::min(K, k0 + KC), N, K, A, B, C);
+    }
+  }, threads);
+}
+
+} // namespace host_simd
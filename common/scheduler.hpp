@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+// Work-stealing scheduler for 1D data-parallel jobs spread over several workers
+// (accelerator_views, host threads, ...).
+//
+//   scheduler::work_stealing s(1 << 20);
+//   s.add_worker("gpu0", [&](int begin, int end) { ...run [begin, end) and wait... });
+//   s.add_worker("host", [&](int begin, int end) { ... });
+//   s.run(N);
+//
+// [0, N) is cut into chunks of `chunk` elements.  Each worker gets its own queue,
+// seeded with a contiguous run of chunks sized by its measured throughput (equal
+// shares on the first run), and one thread that takes chunks from the front of that
+// queue.  A worker whose queue is empty steals from the back of the queue that would
+// take longest to drain, taking the share of it that lets both finish at the same
+// time.  It does not steal if it would finish even one chunk after the victim would
+// have finished everything, so a slow device does not hold up the end of the job.
+//
+// Throughput (elements per second) is kept per worker across run() calls, so later
+// runs start out close to balanced.
+
+namespace scheduler {
+
+struct range {
+  int begin;
+  int end;
+};
+
+struct worker_stats {
+  std::string name;
+  int chunks;             // chunks run in the last run()
+  int stolen;             // of which were stolen from another worker
+  long long elements;     // elements run in the last run()
+  double seconds;         // time spent running chunks in the last run()
+  double throughput;      // elements per second, smoothed over all runs
+};
+
+class work_stealing {
+public:
+  // run(begin, end) must process [begin, end) and only return when it is done
+  typedef std::function<void(int, int)> kernel;
+
+  explicit work_stealing(int chunk) : _chunk(std::max(1, chunk)) {}
+
+  void add_worker(const std::string& name, kernel run) {
+    _workers.push_back(std::unique_ptr<worker>(new worker(name, run)));
+  }
+
+  void run(int n) {
+    if (_workers.empty() || n <= 0) return;
+    seed(n);
+
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < _workers.size(); w++) {
+      threads.push_back(std::thread(&work_stealing::work, this, w));
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  std::vector<worker_stats> stats() const {
+    std::vector<worker_stats> s;
+    for (auto& w : _workers) {
+      s.push_back(w->stats);
+    }
+    return s;
+  }
+
+  void print_stats() const {
+    for (auto& w : _workers) {
+      const worker_stats& s = w->stats;
+      printf("%-12s %6d chunks (%4d stolen) %12lld elements %8.3f s %10.2f M/s\n"
+             , s.name.c_str(), s.chunks, s.stolen, s.elements, s.seconds, s.throughput / 1.0e6);
+    }
+  }
+
+private:
+  struct worker {
+    worker(const std::string& name, kernel run) : run(run) {
+      stats.name = name;
+      stats.chunks = stats.stolen = 0;
+      stats.elements = 0;
+      stats.seconds = stats.throughput = 0.0;
+    }
+
+    kernel run;
+    std::mutex lock;          // guards queue, remaining and stats.throughput
+    std::deque<range> queue;
+    long long remaining = 0;  // elements in queue
+    worker_stats stats;
+  };
+
+  // split [0, n) into chunks and hand out contiguous runs by throughput
+  void seed(int n) {
+    const int numChunks = (n + _chunk - 1) / _chunk;
+
+    // until every worker has been measured, give everyone the same share
+    double total = 0.0;
+    bool measured = true;
+    for (auto& w : _workers) {
+      total += w->stats.throughput;
+      measured = measured && w->stats.throughput > 0.0;
+    }
+
+    int c = 0;
+    double share = 0.0;
+    for (size_t i = 0; i < _workers.size(); i++) {
+      worker& w = *_workers[i];
+      share += measured ? w.stats.throughput / total : 1.0 / _workers.size();
+      int last = (i + 1 == _workers.size()) ? numChunks : std::min(numChunks, int(share * numChunks + 0.5));
+
+      w.queue.clear();
+      w.remaining = 0;
+      for (; c < last; c++) {
+        range r = { c * _chunk, std::min(n, (c + 1) * _chunk) };
+        w.queue.push_back(r);
+        w.remaining += r.end - r.begin;
+      }
+      w.stats.chunks = w.stats.stolen = 0;
+      w.stats.elements = 0;
+      w.stats.seconds = 0.0;
+    }
+  }
+
+  static double rate(worker& w) {
+    std::lock_guard<std::mutex> guard(w.lock);
+    return w.stats.throughput;
+  }
+
+  bool pop(worker& w, range& r) {
+    std::lock_guard<std::mutex> guard(w.lock);
+    if (w.queue.empty()) return false;
+    r = w.queue.front();
+    w.queue.pop_front();
+    w.remaining -= r.end - r.begin;
+    return true;
+  }
+
+  // move part of the slowest-draining queue into the thief's queue
+  bool steal(size_t thief) {
+    worker& me = *_workers[thief];
+    const double myRate = rate(me);
+
+    for (;;) {
+      // victim: the queue with the longest expected time to drain
+      size_t victim = thief;
+      double longest = 0.0;
+      for (size_t v = 0; v < _workers.size(); v++) {
+        if (v == thief) continue;
+        worker& w = *_workers[v];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if (w.queue.empty()) continue;
+        // an unmeasured worker counts as infinitely slow, so it gets stolen from first
+        double t = (w.stats.throughput > 0.0) ? w.remaining / w.stats.throughput : 1.0e30;
+        if (victim == thief || t > longest) {
+          victim = v;
+          longest = t;
+        }
+      }
+      if (victim == thief) return false;
+
+      worker& v = *_workers[victim];
+      std::deque<range> taken;
+      {
+        std::lock_guard<std::mutex> guard(v.lock);
+        if (v.queue.empty()) continue;   // drained meanwhile, look again
+
+        const double victimRate = v.stats.throughput;
+        const range& back = v.queue.back();
+        if (myRate > 0.0 && victimRate > 0.0
+            && (back.end - back.begin) / myRate >= v.remaining / victimRate) {
+          return false;   // the victim finishes sooner than we could run a single chunk
+        }
+
+        // take the share that makes both finish together
+        double share = (myRate > 0.0 && victimRate > 0.0) ? myRate / (myRate + victimRate) : 0.5;
+        size_t count = std::max<size_t>(1, size_t(v.queue.size() * share));
+        for (size_t i = 0; i < count; i++) {
+          taken.push_front(v.queue.back());
+          v.remaining -= v.queue.back().end - v.queue.back().begin;
+          v.queue.pop_back();
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(me.lock);
+      for (auto& r : taken) {
+        me.queue.push_back(r);
+        me.remaining += r.end - r.begin;
+      }
+      me.stats.stolen += int(taken.size());
+      return true;
+    }
+  }
+
+  void work(size_t index) {
+    worker& w = *_workers[index];
+    range r;
+    for (;;) {
+      if (!pop(w, r)) {
+        if (!steal(index)) break;
+        continue;
+      }
+
+      auto start = std::chrono::high_resolution_clock::now();
+      w.run(r.begin, r.end);
+      auto end = std::chrono::high_resolution_clock::now();
+      double t = std::chrono::duration<double>(end - start).count();
+
+      std::lock_guard<std::mutex> guard(w.lock);
+      const int elements = r.end - r.begin;
+      w.stats.chunks++;
+      w.stats.elements += elements;
+      w.stats.seconds += t;
+      if (t > 0.0) {
+        double sample = elements / t;
+        w.stats.throughput = (w.stats.throughput > 0.0) ? 0.75 * w.stats.throughput + 0.25 * sample
+                                                        : sample;
+      }
+    }
+  }
+
+  int _chunk;
+  std::vector<std::unique_ptr<worker>> _workers;
+};
+
+} // namespace scheduler
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <initializer_list>
+#include <hc.hpp>
+
+// Dependency graph of copies and kernels over one or more accelerator_views.
+//
+//   task_graph::graph g;
+//   auto cx = g.copy(view, dev_x, host_x, bytes);
+//   auto cy = g.copy(view, dev_y, host_y, bytes);
+//   auto k  = g.kernel(view, [=](hc::accelerator_view& v) {
+//               return hc::parallel_for_each(v, ...);
+//             }, { cx, cy });
+//   g.copy(view, host_y, dev_y, bytes, { k });
+//   g.submit();     // enqueues everything, never blocks
+//   ...             // the host is free to do other work
+//   g.wait();       // waits on the sinks only
+//
+// A task can only depend on tasks declared before it, so declaration order is a
+// valid submission order.  submit() enqueues every task on its accelerator_view
+// right away.  A dependency on an earlier task of the same view is already
+// guaranteed by the in-order queue; a dependency on another view becomes a blocking
+// marker in front of the task, so the device, not the host, waits on it.
+//
+// Copies go through accelerator_view::copy_async on raw pointers (use
+// array::accelerator_pointer() for hc::array), so they are queue commands the
+// markers can order.
+
+namespace task_graph {
+
+typedef int task;
+
+class graph {
+public:
+  // launch(view) must enqueue the work on view and return its completion_future
+  typedef std::function<hc::completion_future(hc::accelerator_view&)> launcher;
+
+  task copy(const hc::accelerator_view& view, void* dst, const void* src, size_t size
+            , std::initializer_list<task> depends_on = {}) {
+    return add(view, [=](hc::accelerator_view& v) { return v.copy_async(src, dst, size); }, depends_on);
+  }
+
+  task kernel(const hc::accelerator_view& view, launcher launch
+              , std::initializer_list<task> depends_on = {}) {
+    return add(view, launch, depends_on);
+  }
+
+  // enqueue all tasks not submitted yet
+  void submit() {
+    for (; _submitted < _nodes.size(); _submitted++) {
+      node& n = _nodes[_submitted];
+      for (task d : n.depends_on) {
+        node& dep = _nodes[d];
+        if (!(dep.view == n.view)) {
+          n.view.create_blocking_marker(dep.future);
+        }
+      }
+      n.future = n.launch(n.view);
+    }
+  }
+
+  // wait for the tasks nothing else depends on; everything else finished before them
+  void wait() {
+    submit();
+    for (auto& n : _nodes) {
+      if (!n.has_dependents) {
+        n.future.wait();
+      }
+    }
+  }
+
+  hc::completion_future& future(task t) { return _nodes[t].future; }
+
+  size_t size() const { return _nodes.size(); }
+
+private:
+  struct node {
+    node(const hc::accelerator_view& view, launcher launch) : view(view), launch(launch) {}
+
+    hc::accelerator_view view;
+    launcher launch;
+    std::vector<task> depends_on;
+    hc::completion_future future;
+    bool has_dependents = false;
+  };
+
+  task add(const hc::accelerator_view& view, launcher launch, std::initializer_list<task> depends_on) {
+    node n(view, launch);
+    for (task d : depends_on) {
+      if (d >= 0 && d < task(_nodes.size())) {
+        n.depends_on.push_back(d);
+        _nodes[d].has_dependents = true;
+      }
+    }
+    _nodes.push_back(n);
+    return task(_nodes.size()) - 1;
+  }
+
+  std::vector<node> _nodes;
+  size_t _submitted = 0;
+};
+
+} // namespace task_graph
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <hc.hpp>
+
+// Kernel and copy timeline in the Chrome trace format (chrome://tracing, Perfetto).
+//
+//   auto f = trace::parallel_for_each("saxpy", view, extent, [=](hc::index<1> i) [[hc]] { ... });
+//   auto c = trace::copy_async("upload x", view, src, dst, bytes);
+//   { trace::scope s("verify"); ... }                // host work
+//   trace::counter("bytes in flight", n);
+//   trace::write();                                  // at the end of the program
+//
+// Recording is off unless HC_TRACE names an output file, or trace::start() is called;
+// when off the wrappers only forward to hc and cost a flag test.
+//
+// Kernels and copies are timed with the begin and end ticks of their
+// completion_future, i.e. when the device really ran them, not when the host
+// launched or waited.  Host scopes use hc::get_system_ticks(), the same clock, so
+// both line up on one timeline.  Every accelerator_view gets its own track, so
+// overlap between views and devices shows as parallel bars.  The futures are only
+// read in write(), which waits for the ones still running.
+
+namespace trace {
+
+namespace detail {
+
+struct event {
+  std::string name;
+  std::string category;       // "kernel", "copy", "host" or "counter"
+  int track;
+  unsigned long long begin;   // ticks
+  unsigned long long end;
+  size_t bytes;
+  double value;               // counters
+  hc::completion_future future;
+  bool pending;               // begin/end still to be read from future
+};
+
+struct recorder {
+  recorder() {
+    const char* path = getenv("HC_TRACE");
+    if (path != NULL) {
+      file = path;
+      enabled = true;
+    }
+  }
+
+  // one track per accelerator_view, keyed by its HSA queue
+  int view_track(hc::accelerator_view& view) {
+    void* queue = view.get_hsa_queue();
+    auto t = view_tracks.find(queue);
+    if (t != view_tracks.end()) return t->second;
+    int track = int(view_tracks.size());
+    view_tracks[queue] = track;
+    return track;
+  }
+
+  // host threads go on tracks after a gap, so they sort below the views
+  int thread_track() {
+    std::thread::id id = std::this_thread::get_id();
+    auto t = thread_tracks.find(id);
+    if (t != thread_tracks.end()) return t->second;
+    int track = 1000 + int(thread_tracks.size());
+    thread_tracks[id] = track;
+    return track;
+  }
+
+  bool enabled = false;
+  std::string file;
+  std::mutex lock;
+  std::vector<event> events;
+  std::map<void*, int> view_tracks;
+  std::map<std::thread::id, int> thread_tracks;
+};
+
+inline recorder& global() {
+  static recorder r;
+  return r;
+}
+
+inline void add_device(const std::string& name, const char* category, hc::accelerator_view& view
+                       , const hc::completion_future& future, size_t bytes) {
+  recorder& r = global();
+  std::lock_guard<std::mutex> guard(r.lock);
+  event e;
+  e.name = name;
+  e.category = category;
+  e.track = r.view_track(view);
+  e.begin = e.end = 0;
+  e.bytes = bytes;
+  e.value = 0.0;
+  e.future = future;
+  e.pending = true;
+  r.events.push_back(e);
+}
+
+inline double to_us(unsigned long long ticks) {
+  return double(ticks) * 1.0e6 / double(hc::get_system_tick_frequency());
+}
+
+// names are caller supplied, quote them for a JSON string
+inline std::string json_escape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    switch (c) {
+      case '"':  out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+          out += buf;
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out;
+}
+
+} // namespace detail
+
+inline bool enabled() { return detail::global().enabled; }
+
+// start recording, to be written to file
+inline void start(const std::string& file) {
+  detail::global().file = file;
+  detail::global().enabled = true;
+}
+
+template <typename Extent, typename Kernel>
+hc::completion_future parallel_for_each(const std::string& name, hc::accelerator_view view
+                                        , const Extent& extent, const Kernel& kernel) {
+  hc::completion_future f = hc::parallel_for_each(view, extent, kernel);
+  if (enabled()) detail::add_device(name, "kernel", view, f, 0);
+  return f;
+}
+
+inline hc::completion_future copy_async(const std::string& name, hc::accelerator_view view
+                                        , const void* src, void* dst, size_t bytes) {
+  hc::completion_future f = view.copy_async(src, dst, bytes);
+  if (enabled()) detail::add_device(name, "copy", view, f, bytes);
+  return f;
+}
+
+// record a future that was launched some other way (e.g. by a library)
+inline void record(const std::string& name, hc::accelerator_view view
+                   , const hc::completion_future& future, size_t bytes = 0) {
+  if (enabled()) detail::add_device(name, bytes ? "copy" : "kernel", view, future, bytes);
+}
+
+// times the host code in its lifetime
+class scope {
+public:
+  explicit scope(const std::string& name) : _name(name), _begin(enabled() ? hc::get_system_ticks() : 0) {}
+
+  ~scope() {
+    if (!enabled()) return;
+    detail::recorder& r = detail::global();
+    uint64_t end = hc::get_system_ticks();
+    std::lock_guard<std::mutex> guard(r.lock);
+    detail::event e;
+    e.name = _name;
+    e.category = "host";
+    e.track = r.thread_track();
+    e.begin = _begin;
+    e.end = end;
+    e.bytes = 0;
+    e.value = 0.0;
+    e.pending = false;
+    r.events.push_back(e);
+  }
+
+private:
+  std::string _name;
+  uint64_t _begin;
+};
+
+inline void counter(const std::string& name, double value) {
+  if (!enabled()) return;
+  detail::recorder& r = detail::global();
+  uint64_t now = hc::get_system_ticks();
+  std::lock_guard<std::mutex> guard(r.lock);
+  detail::event e;
+  e.name = name;
+  e.category = "counter";
+  e.track = 0;
+  e.begin = e.end = now;
+  e.bytes = 0;
+  e.value = value;
+  e.pending = false;
+  r.events.push_back(e);
+}
+
+// wait for the recorded work and write the trace; returns false if it can't be written
+inline bool write() {
+  detail::recorder& r = detail::global();
+  if (!r.enabled) return true;
+
+  std::lock_guard<std::mutex> guard(r.lock);
+  unsigned long long origin = ~0ULL;
+  for (auto& e : r.events) {
+    if (e.pending) {
+      e.future.wait();
+      e.begin = e.future.get_begin_tick();
+      e.end = e.future.get_end_tick();
+      e.pending = false;
+    }
+    if (e.begin != 0 && e.begin < origin) origin = e.begin;
+  }
+  if (origin == ~0ULL) origin = 0;
+
+  FILE* out = fopen(r.file.c_str(), "w");
+  if (out == NULL) {
+    printf("trace: can't open %s\n", r.file.c_str());
+    return false;
+  }
+
+  fprintf(out, "{\"traceEvents\": [\n");
+  for (auto& t : r.view_tracks) {
+    fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"view %d\"}},\n"
+            , t.second, t.second);
+  }
+  for (auto& t : r.thread_tracks) {
+    fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"host %d\"}},\n"
+            , t.second, t.second - 1000);
+  }
+
+  size_t totalBytes = 0;
+  for (auto& e : r.events) {
+    // a future without timestamps (e.g. an already completed marker) has nothing to show
+    if (e.begin == 0 && e.end == 0) continue;
+
+    double ts = detail::to_us(e.begin - origin);
+    if (e.category == "counter") {
+      fprintf(out, "{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 0, \"ts\": %.3f, \"args\": {\"value\": %g}},\n"
+              , detail::json_escape(e.name).c_str(), ts, e.value);
+      continue;
+    }
+    double dur = detail::to_us(e.end - e.begin);
+    fprintf(out, "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f"
+            , detail::json_escape(e.name).c_str(), detail::json_escape(e.category).c_str(), e.track, ts, dur);
+    if (e.bytes != 0) {
+      totalBytes += e.bytes;
+      fprintf(out, ", \"args\": {\"bytes\": %zu, \"GB/s\": %.2f}", e.bytes
+              , dur > 0.0 ? e.bytes / dur / 1.0e3 : 0.0);
+    }
+    fprintf(out, "},\n");
+  }
+  fprintf(out, "{\"name\": \"bytes copied\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 0, \"ts\": 0, \"args\": {\"bytes\": %zu}}\n"
+          , totalBytes);
+  fprintf(out, "]}\n");
+  fclose(out);
+
+  r.events.clear();
+  return true;
+}
+
+} // namespace trace
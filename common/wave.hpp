@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <hc.hpp>
+#include "hsa.h"
+
+// Typed wavefront collectives.
+//
+//   float s = wave::reduce(x, plus);             // every lane gets the sum over the wavefront
+//   float p = wave::inclusive_scan(x, plus);     // lane i gets x[0] + ... + x[i]
+//   T b     = wave::broadcast(v, src);           // every lane gets lane src's v
+//   T r     = wave::rotate<K>(v);                // lane i gets lane (i + K) % Width's v
+//   uint64_t m = wave::ballot(p);  bool a = wave::any(p), e = wave::all(p);
+//
+// All lanes of the wavefront must be active and make the same call.  T is any
+// trivially copyable type; it is moved between lanes as 32-bit words, padded up to a
+// whole word, so structs, doubles and 64-bit integers work like ints.
+//
+// Every collective takes the wavefront width as a template argument,
+// wave::reduce<Width>(x, op) etc., defaulting to WAVE_SIZE.  Code that should run on
+// both wave32 and wave64 devices is written as a template on Width and instantiated
+// for both; the host picks the one matching the accelerator at run time:
+//
+//   wave::dispatch(hc::accelerator(), [&](auto width) {
+//     launch<decltype(width)::value>(...);
+//   });
+//
+// wave::size() asks HSA for the accelerator's wavefront size; accelerators that aren't
+// HSA agents report WAVE_SIZE.
+//
+// Every lane movement is one of a few patterns, each picking the cheapest hardware
+// path for its compile-time distance and width:
+//   rotate_lanes<K>   K == 1 / Width - 1 on wave64: DPP wave rotate
+//                     (__amdgcn_wave_rl1/rr1), otherwise ds_bpermute
+//   xor_lanes<M>      M < 32: ds_swizzle in bitmask mode, no address computation,
+//                     otherwise ds_bpermute (__shfl_xor)
+//   up_lanes<D>       __shfl_up
+// reduce is a butterfly over xor_lanes, so the result ends up in every lane without
+// a final broadcast; inclusive_scan is Hillis-Steele over up_lanes.
+//
+// wave::emulated has the same collectives over a whole wavefront held in an array
+// on the host, the width being the array's length.  They take the same steps with
+// the same patterns and the same word splitting, moving words with each pattern's
+// source(), so the collectives can be checked without a GPU.
+
+namespace wave {
+
+// the widest wavefront, and the width assumed when none is given
+constexpr int WAVE_SIZE = 64;
+
+template <int Width>
+using width = std::integral_constant<int, Width>;
+
+// wavefront size of acc
+inline int size(const hc::accelerator& acc = hc::accelerator()) {
+  if (!acc.is_hsa_accelerator()) return WAVE_SIZE;
+  hc::accelerator_view av = acc.get_default_view();
+  hsa_agent_t* agent = static_cast<hsa_agent_t*>(av.get_hsa_agent());
+  if (agent == NULL) return WAVE_SIZE;
+  uint32_t s = 0;
+  if (hsa_agent_get_info(*agent, HSA_AGENT_INFO_WAVEFRONT_SIZE, &s)
+      != HSA_STATUS_SUCCESS) {
+    return WAVE_SIZE;
+  }
+  return int(s);
+}
+
+// f(width<32>()) on wave32 accelerators, f(width<64>()) on all others
+template <typename F>
+void dispatch(const hc::accelerator& acc, F f) {
+  if (size(acc) == 32) f(width<32>());
+  else f(width<64>());
+}
+
+namespace detail {
+
+template <typename T>
+struct words {
+  static_assert(std::is_trivially_copyable<T>::value, "wave collectives move trivially copyable types");
+  static constexpr int COUNT = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+  int word[COUNT];
+};
+
+template <typename T>
+words<T> split(const T& v) [[cpu, hc]] {
+  words<T> w;
+  w.word[words<T>::COUNT - 1] = 0;
+  __builtin_memcpy(w.word, &v, sizeof(T));
+  return w;
+}
+
+template <typename T>
+T join(const words<T>& w) [[cpu, hc]] {
+  T v;
+  __builtin_memcpy(&v, w.word, sizeof(T));
+  return v;
+}
+
+} // namespace detail
+
+
+//---
+// Lane patterns: source(lane) is the lane whose value lane receives,
+// move(x) does it for one 32-bit word on the device.
+
+// K may be negative, rotate_lanes<-1> moves values one lane up
+template <int K, int Width = WAVE_SIZE>
+struct rotate_lanes {
+  static constexpr int SHIFT = (K % Width + Width) % Width;
+  static int source(int lane) [[cpu, hc]] { return (lane + SHIFT) % Width; }
+  static int move(int x) [[hc]] {
+    if (SHIFT == 0) return x;
+    // the DPP wave rotates only exist for 64-wide wavefronts
+    if (Width == 64 && SHIFT == 1) return hc::__amdgcn_wave_rl1(x);
+    if (Width == 64 && SHIFT == Width - 1) return hc::__amdgcn_wave_rr1(x);
+    return hc::__amdgcn_ds_bpermute(source(hc::__lane_id()) << 2, x);
+  }
+};
+
+template <int M, int Width = WAVE_SIZE>
+struct xor_lanes {
+  static int source(int lane) [[cpu, hc]] { return lane ^ M; }
+  static int move(int x) [[hc]] {
+    // bitmask swizzle within groups of 32: and_mask 0x1f, or_mask 0, xor_mask M
+    if (M < 32) return hc::__amdgcn_ds_swizzle(x, (M << 10) | 0x1f);
+    return hc::__amdgcn_ds_bpermute(source(hc::__lane_id()) << 2, x);
+  }
+};
+
+// lanes below D keep their own value
+template <int D, int Width = WAVE_SIZE>
+struct up_lanes {
+  static int source(int lane) [[cpu, hc]] { return (lane >= D) ? lane - D : lane; }
+  static int move(int x) [[hc]] { return hc::__shfl_up(x, D, Width); }
+};
+
+template <typename Pattern, typename T>
+T move(const T& v) [[hc]] {
+  detail::words<T> w = detail::split(v);
+  for (int i = 0; i < detail::words<T>::COUNT; i++) {
+    w.word[i] = Pattern::move(w.word[i]);
+  }
+  return detail::join<T>(w);
+}
+
+
+//---
+// Collectives
+
+namespace detail {
+
+template <int M, int Width>
+struct butterfly {
+  template <typename T, typename Op>
+  static T run(T v, Op op) [[hc]] {
+    v = op(v, move<xor_lanes<M, Width>>(v));
+    return butterfly<M / 2, Width>::run(v, op);
+  }
+};
+
+template <int Width>
+struct butterfly<0, Width> {
+  template <typename T, typename Op>
+  static T run(T v, Op) [[hc]] { return v; }
+};
+
+template <int D, int Width>
+struct hillis_steele {
+  template <typename T, typename Op>
+  static T run(T v, int lane, Op op) [[hc]] {
+    T other = move<up_lanes<D, Width>>(v);
+    if (lane >= D) v = op(other, v);
+    return hillis_steele<D * 2, Width>::run(v, lane, op);
+  }
+};
+
+template <int Width>
+struct hillis_steele<Width, Width> {
+  template <typename T, typename Op>
+  static T run(T v, int, Op) [[hc]] { return v; }
+};
+
+} // namespace detail
+
+// op must be associative and commutative
+template <int Width = WAVE_SIZE, typename T, typename Op>
+T reduce(T v, Op op) [[hc]] {
+  return detail::butterfly<Width / 2, Width>::run(v, op);
+}
+
+// op must be associative
+template <int Width = WAVE_SIZE, typename T, typename Op>
+T inclusive_scan(T v, Op op) [[hc]] {
+  return detail::hillis_steele<1, Width>::run(v, hc::__lane_id(), op);
+}
+
+template <int Width = WAVE_SIZE, typename T>
+T broadcast(T v, int src) [[hc]] {
+  detail::words<T> w = detail::split(v);
+  for (int i = 0; i < detail::words<T>::COUNT; i++) {
+    w.word[i] = hc::__shfl(w.word[i], src, Width);
+  }
+  return detail::join<T>(w);
+}
+
+template <int K, int Width = WAVE_SIZE, typename T>
+T rotate(T v) [[hc]] {
+  return move<rotate_lanes<K, Width>>(v);
+}
+
+// bit i set if lane i's p is true; bits past the wavefront width are 0
+inline uint64_t ballot(bool p) [[hc]] { return hc::__ballot(p); }
+inline bool any(bool p) [[hc]] { return hc::__any(p) != 0; }
+inline bool all(bool p) [[hc]] { return hc::__all(p) != 0; }
+
+
+//---
+// Host emulation, one array element per lane
+
+namespace emulated {
+
+template <typename Pattern, typename T, int Width>
+void move(T (&lanes)[Width]) {
+  wave::detail::words<T> w[Width];
+  for (int l = 0; l < Width; l++) w[l] = wave::detail::split(lanes[l]);
+  for (int l = 0; l < Width; l++) lanes[l] = wave::detail::join<T>(w[Pattern::source(l)]);
+}
+
+namespace detail {
+
+template <int M, int Width>
+struct butterfly {
+  template <typename T, typename Op>
+  static void run(T (&lanes)[Width], Op op) {
+    T other[Width];
+    for (int l = 0; l < Width; l++) other[l] = lanes[l];
+    move<xor_lanes<M, Width>>(other);
+    for (int l = 0; l < Width; l++) lanes[l] = op(lanes[l], other[l]);
+    butterfly<M / 2, Width>::run(lanes, op);
+  }
+};
+
+template <int Width>
+struct butterfly<0, Width> {
+  template <typename T, typename Op>
+  static void run(T (&)[Width], Op) {}
+};
+
+template <int D, int Width>
+struct hillis_steele {
+  template <typename T, typename Op>
+  static void run(T (&lanes)[Width], Op op) {
+    T other[Width];
+    for (int l = 0; l < Width; l++) other[l] = lanes[l];
+    move<up_lanes<D, Width>>(other);
+    for (int l = D; l < Width; l++) lanes[l] = op(other[l], lanes[l]);
+    hillis_steele<D * 2, Width>::run(lanes, op);
+  }
+};
+
+template <int Width>
+struct hillis_steele<Width, Width> {
+  template <typename T, typename Op>
+  static void run(T (&)[Width], Op) {}
+};
+
+} // namespace detail
+
+template <typename T, int Width, typename Op>
+void reduce(T (&lanes)[Width], Op op) {
+  detail::butterfly<Width / 2, Width>::run(lanes, op);
+}
+
+template <typename T, int Width, typename Op>
+void inclusive_scan(T (&lanes)[Width], Op op) {
+  detail::hillis_steele<1, Width>::run(lanes, op);
+}
+
+template <typename T, int Width>
+void broadcast(T (&lanes)[Width], int src) {
+  T v = lanes[src];
+  for (int l = 0; l < Width; l++) lanes[l] = v;
+}
+
+template <int K, typename T, int Width>
+void rotate(T (&lanes)[Width]) {
+  move<rotate_lanes<K, Width>>(lanes);
+}
+
+template <int Width>
+uint64_t ballot(const bool (&p)[Width]) {
+  uint64_t m = 0;
+  for (int l = 0; l < Width; l++) {
+    if (p[l]) m |= uint64_t(1) << l;
+  }
+  return m;
+}
+
+template <int Width>
+bool any(const bool (&p)[Width]) { return ballot(p) != 0; }
+
+template <int Width>
+bool all(const bool (&p)[Width]) { return ballot(p) == (~uint64_t(0) >> (64 - Width)); }
+
+} // namespace emulated
+
+} // namespace wave
@@ -6,7 +6,7 @@
 
 // header file for the hc API
 #include <hc.hpp>
-#include <hc_am.hpp>
+#include "hc_am.hpp"
 
 #define N  (1024 * 500)
 
@@ -31,10 +31,11 @@ int main() {
     host_result_y[i] = a * host_x[i] + host_y[i];
   }
 
-  // allocate GPU memory through am_alloc
+  // allocate GPU memory through am_alloc; on an accelerator without HSA this is
+  // host memory and the same code runs unchanged
   hc::accelerator acc;
-  float* x = hc::am_alloc(N * sizeof(float), acc, 0);
-  float* y = hc::am_alloc(N * sizeof(float), acc, 0);
+  float* x = hc::am_alloc(N * sizeof(float), AM_EXPLICIT_SYNC, acc.get_default_view());
+  float* y = hc::am_alloc(N * sizeof(float), AM_EXPLICIT_SYNC, acc.get_default_view());
 
   // copy the data from host to GPU
   hc::am_copy(x, host_x, N * sizeof(float));
@@ -53,6 +54,9 @@ int main() {
 
   // copy the data from GPU to host
   hc::am_copy(host_y, y, N * sizeof(float));
+
+  hc::am_free(x);
+  hc::am_free(y);
    
   // verify the results
   int errors = 0;
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <hc.hpp>
+#include "host_simd.hpp"
+
+// Blocked GEMM, C = A * B with A MxK, B KxN and C MxN, all row-major.
+//
+// A workgroup of TILE x TILE work-items computes a BLOCK x BLOCK block of C,
+// BLOCK = TILE * MICRO.  For every step of TILE_K along K it stages a BLOCK x TILE_K
+// panel of A and a TILE_K x BLOCK panel of B in tile_static memory, and each
+// work-item then accumulates a MICRO x MICRO micro-tile in registers.  The rows and
+// columns of a micro-tile are TILE apart, so neighbouring work-items read neighbouring
+// tile_static elements.  Panels are zero padded at the matrix edges, so M, N and K
+// can be anything.
+
+namespace gemm {
+
+constexpr int TILE = 16;
+constexpr int MICRO = 4;
+constexpr int BLOCK = TILE * MICRO;
+constexpr int TILE_K = 16;
+
+template <typename T>
+hc::completion_future blocked(const hc::array_view<const T,2>& av_mat_A
+                            , const hc::array_view<const T,2>& av_mat_B
+                            , const hc::array_view<T,2>& av_mat_C) {
+
+  const int M = av_mat_C.get_extent()[0];
+  const int N = av_mat_C.get_extent()[1];
+  const int K = av_mat_A.get_extent()[1];
+
+  // one work-item per TILE x TILE slot of each BLOCK x BLOCK block of C
+  hc::extent<2> grid(((M + BLOCK - 1) / BLOCK) * TILE, ((N + BLOCK - 1) / BLOCK) * TILE);
+
+  av_mat_C.discard_data();
+  return hc::parallel_for_each(grid.tile(TILE, TILE), [=](hc::tiled_index<2> tidx) [[hc]] {
+
+    tile_static T panelA[BLOCK][TILE_K + 1];    // +1 avoids bank conflicts on column reads
+    tile_static T panelB[TILE_K][BLOCK];
+
+    const int ty = tidx.local[0];
+    const int tx = tidx.local[1];
+    const int blockRow = tidx.tile[0] * BLOCK;
+    const int blockCol = tidx.tile[1] * BLOCK;
+    const int flatID = ty * TILE + tx;
+
+    T acc[MICRO][MICRO];
+    for (int i = 0; i < MICRO; i++)
+      for (int j = 0; j < MICRO; j++)
+        acc[i][j] = T(0);
+
+    for (int k0 = 0; k0 < K; k0 += TILE_K) {
+
+      // each work-item loads BLOCK * TILE_K / (TILE * TILE) elements of each panel
+      for (int e = flatID; e < BLOCK * TILE_K; e += TILE * TILE) {
+        int r = e / TILE_K;
+        int c = e % TILE_K;
+        int gr = blockRow + r;
+        int gc = k0 + c;
+        panelA[r][c] = (gr < M && gc < K) ? av_mat_A(gr, gc) : T(0);
+
+        r = e / BLOCK;
+        c = e % BLOCK;
+        gr = k0 + r;
+        gc = blockCol + c;
+        panelB[r][c] = (gr < K && gc < N) ? av_mat_B(gr, gc) : T(0);
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+
+      for (int kk = 0; kk < TILE_K; kk++) {
+        T a[MICRO];
+        T b[MICRO];
+        for (int i = 0; i < MICRO; i++)
+          a[i] = panelA[ty + i * TILE][kk];
+        for (int j = 0; j < MICRO; j++)
+          b[j] = panelB[kk][tx + j * TILE];
+        for (int i = 0; i < MICRO; i++)
+          for (int j = 0; j < MICRO; j++)
+            acc[i][j] += a[i] * b[j];
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+    }
+
+    for (int i = 0; i < MICRO; i++) {
+      int row = blockRow + ty + i * TILE;
+      for (int j = 0; j < MICRO; j++) {
+        int col = blockCol + tx + j * TILE;
+        if (row < M && col < N)
+          av_mat_C(row, col) = acc[i][j];
+      }
+    }
+  });
+}
+
+// Packed operands.  A is stored as panels of BLOCK rows and B as panels of BLOCK
+// columns, each panel k-major and zero padded to whole blocks and to a multiple of
+// TILE_K along K:
+//
+//   packed A:  panel p holds rows [p*BLOCK, p*BLOCK+BLOCK), element (r, k) at p*Kp*BLOCK + k*BLOCK + r
+//   packed B:  panel p holds cols [p*BLOCK, p*BLOCK+BLOCK), element (k, c) at p*Kp*BLOCK + k*BLOCK + c
+//
+// so the BLOCK x TILE_K slice blocked_packed stages for one step is one contiguous run
+// of memory for either operand, read with unit stride and without edge checks.
+
+template <typename T>
+struct packed_matrix {
+  hc::array_view<T,1> data;
+  int rows;           // rows of A or columns of B
+  int K;
+  int panels;
+  int Kp;             // K padded to a multiple of TILE_K
+
+  packed_matrix(int rows, int K)
+    : data(((rows + BLOCK - 1) / BLOCK) * BLOCK * (((K + TILE_K - 1) / TILE_K) * TILE_K))
+    , rows(rows), K(K)
+    , panels((rows + BLOCK - 1) / BLOCK)
+    , Kp(((K + TILE_K - 1) / TILE_K) * TILE_K) {}
+};
+
+namespace detail {
+
+// transposed selects B, where the panel runs over columns of the source
+template <typename T>
+packed_matrix<T> pack(const hc::array_view<const T,2>& av_src, bool transposed) {
+  const int rows = transposed ? av_src.get_extent()[1] : av_src.get_extent()[0];
+  const int K = transposed ? av_src.get_extent()[0] : av_src.get_extent()[1];
+  packed_matrix<T> packed(rows, K);
+
+  hc::array_view<T,1> data = packed.data;
+  const int Kp = packed.Kp;
+  data.discard_data();
+  hc::parallel_for_each(data.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    int i = idx[0];
+    int panel = i / (Kp * BLOCK);
+    int k = (i / BLOCK) % Kp;
+    int r = panel * BLOCK + i % BLOCK;
+    T v = T(0);
+    if (r < rows && k < K)
+      v = transposed ? av_src(k, r) : av_src(r, k);
+    data[i] = v;
+  });
+  return packed;
+}
+
+} // namespace detail
+
+template <typename T>
+packed_matrix<T> pack_a(const hc::array_view<const T,2>& av_mat_A) {
+  return detail::pack<T>(av_mat_A, false);
+}
+
+template <typename T>
+packed_matrix<T> pack_b(const hc::array_view<const T,2>& av_mat_B) {
+  return detail::pack<T>(av_mat_B, true);
+}
+
+// Packed operands kept across calls, keyed by the caller's id for the matrix (for
+// example the address of a weight tensor) and its shape.  Call invalidate when the
+// matrix behind an id changes.
+template <typename T>
+class pack_cache {
+public:
+  const packed_matrix<T>& a(const void* id, const hc::array_view<const T,2>& av_mat_A) {
+    return get(id, false, av_mat_A);
+  }
+
+  const packed_matrix<T>& b(const void* id, const hc::array_view<const T,2>& av_mat_B) {
+    return get(id, true, av_mat_B);
+  }
+
+  void invalidate(const void* id) {
+    for (auto it = _cache.begin(); it != _cache.end(); ) {
+      if (std::get<0>(it->first) == id)
+        it = _cache.erase(it);
+      else
+        ++it;
+    }
+  }
+
+private:
+  typedef std::tuple<const void*, bool, int, int> key;
+
+  const packed_matrix<T>& get(const void* id, bool transposed, const hc::array_view<const T,2>& av_src) {
+    key k(id, transposed, av_src.get_extent()[0], av_src.get_extent()[1]);
+    auto it = _cache.find(k);
+    if (it == _cache.end()) {
+      it = _cache.insert(std::make_pair(k, detail::pack<T>(av_src, transposed))).first;
+    }
+    return it->second;
+  }
+
+  std::map<key, packed_matrix<T>> _cache;
+};
+
+// blocked() on packed operands, C = A * B.  The packs carry no bounds the kernel
+// could check, so mismatched shapes stop the program instead of reading past a pack.
+template <typename T>
+hc::completion_future blocked_packed(const packed_matrix<T>& packedA
+                                   , const packed_matrix<T>& packedB
+                                   , const hc::array_view<T,2>& av_mat_C) {
+
+  const int M = av_mat_C.get_extent()[0];
+  const int N = av_mat_C.get_extent()[1];
+  if (packedA.K != packedB.K || packedA.rows != M || packedB.rows != N) {
+    fprintf(stderr, "gemm: blocked_packed on A %dx%d, B %dx%d, C %dx%d\n"
+           , packedA.rows, packedA.K, packedB.K, packedB.rows, M, N);
+    abort();
+  }
+  const int Kp = packedA.Kp;
+  hc::array_view<const T,1> pa = packedA.data;
+  hc::array_view<const T,1> pb = packedB.data;
+
+  hc::extent<2> grid(packedA.panels * TILE, packedB.panels * TILE);
+
+  av_mat_C.discard_data();
+  return hc::parallel_for_each(grid.tile(TILE, TILE), [=](hc::tiled_index<2> tidx) [[hc]] {
+
+    tile_static T panelA[TILE_K][BLOCK];
+    tile_static T panelB[TILE_K][BLOCK];
+
+    const int ty = tidx.local[0];
+    const int tx = tidx.local[1];
+    const int flatID = ty * TILE + tx;
+    const int baseA = tidx.tile[0] * Kp * BLOCK;
+    const int baseB = tidx.tile[1] * Kp * BLOCK;
+
+    T acc[MICRO][MICRO];
+    for (int i = 0; i < MICRO; i++)
+      for (int j = 0; j < MICRO; j++)
+        acc[i][j] = T(0);
+
+    for (int k0 = 0; k0 < Kp; k0 += TILE_K) {
+
+      // both slices are contiguous in the packed layout
+      for (int e = flatID; e < BLOCK * TILE_K; e += TILE * TILE) {
+        panelA[e / BLOCK][e % BLOCK] = pa[baseA + k0 * BLOCK + e];
+        panelB[e / BLOCK][e % BLOCK] = pb[baseB + k0 * BLOCK + e];
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+
+      for (int kk = 0; kk < TILE_K; kk++) {
+        T a[MICRO];
+        T b[MICRO];
+        for (int i = 0; i < MICRO; i++)
+          a[i] = panelA[kk][ty + i * TILE];
+        for (int j = 0; j < MICRO; j++)
+          b[j] = panelB[kk][tx + j * TILE];
+        for (int i = 0; i < MICRO; i++)
+          for (int j = 0; j < MICRO; j++)
+            acc[i][j] += a[i] * b[j];
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+    }
+
+    const int blockRow = tidx.tile[0] * BLOCK;
+    const int blockCol = tidx.tile[1] * BLOCK;
+    for (int i = 0; i < MICRO; i++) {
+      int row = blockRow + ty + i * TILE;
+      for (int j = 0; j < MICRO; j++) {
+        int col = blockCol + tx + j * TILE;
+        if (row < M && col < N)
+          av_mat_C(row, col) = acc[i][j];
+      }
+    }
+  });
+}
+
+// Batched GEMM for many small products, C[b] = A[b] * B[b] for b < count, every
+// product MxK times KxN.  The whole batch is one launch.  A workgroup of
+// BATCH_TILE work-items handles BATCH_TILE / (M*N) matrices, rounded down to a power
+// of two and at least one, and the work-items assigned to a matrix stride over its
+// elements.  The matrices are small enough for the caches to serve the repeated
+// reads of A and B.
+//
+// Two ways to describe a batch:
+//   strided        - matrix b starts at b * stride in one flat array_view
+//   pointer array  - pointer b of an array_view of pointers; the pointers and the
+//                    matrices they point to must be accessible from the accelerator,
+//                    e.g. allocated with hc::am_alloc
+
+constexpr int BATCH_TILE = 256;
+
+namespace detail {
+
+template <typename T>
+struct strided_batch {
+  hc::array_view<const T,1> a, b;
+  hc::array_view<T,1> c;
+  int strideA, strideB, strideC;
+
+  T A(int m, int i) const [[hc]] { return a[m * strideA + i]; }
+  T B(int m, int i) const [[hc]] { return b[m * strideB + i]; }
+  void C(int m, int i, T v) const [[hc]] { c[m * strideC + i] = v; }
+};
+
+template <typename T>
+struct pointer_batch {
+  hc::array_view<const T* const,1> a, b;
+  hc::array_view<T* const,1> c;
+
+  T A(int m, int i) const [[hc]] { return a[m][i]; }
+  T B(int m, int i) const [[hc]] { return b[m][i]; }
+  void C(int m, int i, T v) const [[hc]] { c[m][i] = v; }
+};
+
+inline int matrices_per_tile(int M, int N) {
+  int mats = 1;
+  while (mats * 2 * M * N <= BATCH_TILE) mats *= 2;
+  return mats;
+}
+
+template <typename T, typename Batch>
+hc::completion_future batched(const Batch& batch, int count, int M, int N, int K) {
+  const int matsPerTile = matrices_per_tile(M, N);
+  const int threadsPerMat = BATCH_TILE / matsPerTile;
+  const int numTiles = (count + matsPerTile - 1) / matsPerTile;
+
+  hc::extent<1> grid(numTiles * BATCH_TILE);
+  return hc::parallel_for_each(grid.tile(BATCH_TILE), [=](hc::tiled_index<1> tidx) [[hc]] {
+    const int localID = tidx.local[0];
+    const int m = tidx.tile[0] * matsPerTile + localID / threadsPerMat;
+    if (m >= count)
+      return;
+
+    for (int e = localID % threadsPerMat; e < M * N; e += threadsPerMat) {
+      const int row = e / N;
+      const int col = e % N;
+      T p = T(0);
+      for (int k = 0; k < K; k++) {
+        p += batch.A(m, row * K + k) * batch.B(m, k * N + col);
+      }
+      batch.C(m, e, p);
+    }
+  });
+}
+
+} // namespace detail
+
+template <typename T>
+hc::completion_future batched(const hc::array_view<const T,1>& av_A, int strideA
+                            , const hc::array_view<const T,1>& av_B, int strideB
+                            , const hc::array_view<T,1>& av_C, int strideC
+                            , int count, int M, int N, int K) {
+  detail::strided_batch<T> batch = { av_A, av_B, av_C, strideA, strideB, strideC };
+  return detail::batched<T>(batch, count, M, N, K);
+}
+
+template <typename T>
+hc::completion_future batched(const hc::array_view<const T* const,1>& av_A
+                            , const hc::array_view<const T* const,1>& av_B
+                            , const hc::array_view<T* const,1>& av_C
+                            , int count, int M, int N, int K) {
+  detail::pointer_batch<T> batch = { av_A, av_B, av_C };
+  return detail::batched<T>(batch, count, M, N, K);
+}
+
+// One work-item per element of C, reading A and B straight from global memory.
+template <typename T>
+hc::completion_future naive(const hc::array_view<const T,2>& av_mat_A
+                          , const hc::array_view<const T,2>& av_mat_B
+                          , const hc::array_view<T,2>& av_mat_C) {
+
+  const int K = av_mat_A.get_extent()[1];
+
+  av_mat_C.discard_data();
+  return hc::parallel_for_each(av_mat_C.get_extent(), [=](hc::index<2> idx) [[hc]] {
+    T p = T(0);
+    for (int n = 0; n < K; n++) {
+      p += av_mat_A(idx[0], n) * av_mat_B(n, idx[1]);
+    }
+    av_mat_C(idx) = p;
+  });
+}
+
+// C = A * B on the host with the SIMD host backend.
+template <typename T>
+hc::completion_future host(const hc::array_view<const T,2>& av_mat_A
+                         , const hc::array_view<const T,2>& av_mat_B
+                         , const hc::array_view<T,2>& av_mat_C) {
+  av_mat_A.synchronize();
+  av_mat_B.synchronize();
+  av_mat_C.discard_data();
+  host_simd::gemm(av_mat_C.get_extent()[0], av_mat_C.get_extent()[1], av_mat_A.get_extent()[1]
+                  , av_mat_A.data(), av_mat_B.data(), av_mat_C.data());
+  return hc::completion_future();
+}
+
+// blocked() on an HSA accelerator, host() when there is none.
+template <typename T>
+hc::completion_future multiply(const hc::array_view<const T,2>& av_mat_A
+                             , const hc::array_view<const T,2>& av_mat_B
+                             , const hc::array_view<T,2>& av_mat_C) {
+  if (hc::accelerator().is_hsa_accelerator())
+    return blocked<T>(av_mat_A, av_mat_B, av_mat_C);
+  return host<T>(av_mat_A, av_mat_B, av_mat_C);
+}
+
+} // namespace gemm
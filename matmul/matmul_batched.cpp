@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <hc.hpp>
+#include "gemm.hpp"
+
+constexpr int RAND_N = 10;
+
+// elements per operand over the whole batch, the batch count follows from it
+constexpr int BATCH_ELEMENTS = 1024 * 1024;
+
+template <typename F>
+double seconds(F f) {
+  f();    // warm up, this also moves the data to the accelerator
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int run(int S) {
+
+  const int count = BATCH_ELEMENTS / (S * S);
+  const int size = S * S;
+
+  std::vector<float> matA(count * size);
+  std::vector<float> matB(count * size);
+  std::vector<float> matC(count * size);
+  std::vector<float> matC_batched(count * size);
+  std::vector<float> matC_single(count * size);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<int> distribution(0, RAND_N);
+  std::generate(matA.begin(), matA.end(), [&]() { return float(distribution(random_gen)); });
+  std::generate(matB.begin(), matB.end(), [&]() { return float(distribution(random_gen)); });
+
+  // compute the products on the host
+  for (int b = 0; b < count; b++) {
+    for (int j = 0; j < S; j++) {
+      for (int i = 0; i < S; i++) {
+        float p = 0.0f;
+        for (int n = 0; n < S; n++) {
+          p += matA[b * size + j * S + n] * matB[b * size + n * S + i];
+        }
+        matC[b * size + j * S + i] = p;
+      }
+    }
+  }
+
+  hc::array_view<const float,1> av_A(count * size, matA);
+  hc::array_view<const float,1> av_B(count * size, matB);
+  hc::array_view<float,1> av_C_batched(count * size, matC_batched);
+  hc::array_view<float,1> av_C_single(count * size, matC_single);
+
+  // one launch for the whole batch
+  double batched = seconds([&]() {
+    gemm::batched<float>(av_A, size, av_B, size, av_C_batched, size, count, S, S, S).wait();
+  });
+
+  // one launch per product
+  double single = seconds([&]() {
+    hc::completion_future last;
+    for (int b = 0; b < count; b++) {
+      hc::extent<1> e(size);
+      hc::index<1> offset(b * size);
+      last = gemm::naive<float>(av_A.section(offset, e).view_as(hc::extent<2>(S, S))
+                              , av_B.section(offset, e).view_as(hc::extent<2>(S, S))
+                              , av_C_single.section(offset, e).view_as(hc::extent<2>(S, S)));
+    }
+    last.wait();
+  });
+
+  av_C_batched.synchronize();
+  av_C_single.synchronize();
+
+  int errors = 0;
+  for (int i = 0; i < count * size; i++) {
+    if (matC[i] != matC_batched[i] || matC[i] != matC_single[i])
+      errors++;
+  }
+
+  printf("%4dx%-4d x %6d  batched %10.0f products/s  per-product launch %10.0f products/s  %s\n"
+         , S, S, count, count / batched, count / single, errors ? "failed" : "passed");
+  return errors;
+}
+
+int main() {
+  // batched() has no host version
+  if (!hc::accelerator().is_hsa_accelerator()) {
+    printf("no HSA accelerator, skipped\n");
+    return 0;
+  }
+
+  int errors = 0;
+  for (int S = 8; S <= 128; S *= 2) {
+    errors += run(S);
+  }
+  return errors;
+}
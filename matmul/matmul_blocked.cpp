@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <hc.hpp>
+#include "gemm.hpp"
+
+constexpr int RAND_N = 10;
+constexpr int ITERATIONS = 5;
+
+template <typename T>
+bool close_enough(T expected, T actual) {
+  return std::fabs(double(expected) - double(actual)) <= std::fabs(double(expected)) * 1e-4;
+}
+
+template <typename T, typename F>
+double gflops(F gemm_kernel, int M, int N, int K) {
+
+  // warm up, this also moves the data to the accelerator
+  gemm_kernel().wait();
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    gemm_kernel().wait();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count() / ITERATIONS;
+  return 2.0 * M * N * K / seconds / 1.0e9;
+}
+
+template <typename T>
+int run(const char* type, int M, int N, int K) {
+
+  std::vector<T> matA(M * K);
+  std::vector<T> matB(K * N);
+  std::vector<T> matC(M * N);
+  std::vector<T> matC_naive(M * N);
+  std::vector<T> matC_blocked(M * N);
+  std::vector<T> matC_host(M * N);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<int> distribution(0, RAND_N);
+  std::generate(matA.begin(), matA.end(), [&]() { return T(distribution(random_gen)); });
+  std::generate(matB.begin(), matB.end(), [&]() { return T(distribution(random_gen)); });
+
+  // compute the dot product on the host
+  for (int j = 0; j < M; j++) {
+    for (int i = 0; i < N; i++) {
+      T p = T(0);
+      for (int n = 0; n < K; n++) {
+        p += matA[j * K + n] * matB[n * N + i];
+      }
+      matC[j * N + i] = p;
+    }
+  }
+
+  hc::array_view<const T, 2> av_mat_A(M, K, matA);
+  hc::array_view<const T, 2> av_mat_B(K, N, matB);
+  hc::array_view<T, 2> av_mat_C_naive(M, N, matC_naive);
+  hc::array_view<T, 2> av_mat_C_blocked(M, N, matC_blocked);
+  hc::array_view<T, 2> av_mat_C_host(M, N, matC_host);
+
+  // naive() needs an HSA accelerator; multiply() runs blocked() on one and host() otherwise
+  const bool hsa = hc::accelerator().is_hsa_accelerator();
+  double naive = 0.0;
+  if (hsa) {
+    naive = gflops<T>([&]() {
+      return gemm::naive<T>(av_mat_A, av_mat_B, av_mat_C_naive);
+    }, M, N, K);
+  }
+  double blocked = gflops<T>([&]() {
+    return gemm::multiply<T>(av_mat_A, av_mat_B, av_mat_C_blocked);
+  }, M, N, K);
+  double host = gflops<T>([&]() {
+    return gemm::host<T>(av_mat_A, av_mat_B, av_mat_C_host);
+  }, M, N, K);
+
+  av_mat_C_naive.synchronize();
+  av_mat_C_blocked.synchronize();
+
+  int errors = 0;
+  for (int i = 0; i < M * N; i++) {
+    if ((hsa && !close_enough(matC[i], matC_naive[i])) || !close_enough(matC[i], matC_blocked[i])
+        || !close_enough(matC[i], matC_host[i]))
+      errors++;
+  }
+
+  printf("%-6s %5dx%5dx%5d  naive %8.2f GFLOP/s  %s %8.2f GFLOP/s  host (%s) %8.2f GFLOP/s  %s\n"
+         , type, M, N, K, naive, hsa ? "blocked" : "multiply", blocked
+         , host_simd::isa_name(host_simd::detect()), host, errors ? "failed" : "passed");
+  return errors;
+}
+
+int main(int argc, char* argv[]) {
+
+  // default to a shape that is not a multiple of the block size
+  int M = 1000, N = 1000, K = 1000;
+  if (argc == 4) {
+    M = atoi(argv[1]);
+    N = atoi(argv[2]);
+    K = atoi(argv[3]);
+  }
+
+  int errors = 0;
+  errors += run<float>("float", M, N, K);
+  errors += run<double>("double", M, N, K);
+  errors += run<int>("int", M, N, K);
+  return errors;
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <hc.hpp>
+#include "gemm.hpp"
+
+constexpr int RAND_N = 10;
+constexpr int ITERATIONS = 5;
+
+// Multiply several inputs by the same weight matrix.  The weights are packed
+// once and reused from the cache, each input is packed on every call.
+
+int main(int argc, char* argv[]) {
+
+  // blocked_packed() has no host version
+  if (!hc::accelerator().is_hsa_accelerator()) {
+    printf("no HSA accelerator, skipped\n");
+    return 0;
+  }
+
+  int M = 1000, N = 1000, K = 1000;
+  if (argc == 4) {
+    M = atoi(argv[1]);
+    N = atoi(argv[2]);
+    K = atoi(argv[3]);
+  }
+
+  std::vector<float> matA(M * K);
+  std::vector<float> weights(K * N);
+  std::vector<float> matC(M * N);
+  std::vector<float> matC_blocked(M * N);
+  std::vector<float> matC_packed(M * N);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<int> distribution(0, RAND_N);
+  std::generate(matA.begin(), matA.end(), [&]() { return float(distribution(random_gen)); });
+  std::generate(weights.begin(), weights.end(), [&]() { return float(distribution(random_gen)); });
+
+  // compute the dot product on the host
+  for (int j = 0; j < M; j++) {
+    for (int i = 0; i < N; i++) {
+      float p = 0.0f;
+      for (int n = 0; n < K; n++) {
+        p += matA[j * K + n] * weights[n * N + i];
+      }
+      matC[j * N + i] = p;
+    }
+  }
+
+  hc::array_view<const float, 2> av_mat_A(M, K, matA);
+  hc::array_view<const float, 2> av_weights(K, N, weights);
+  hc::array_view<float, 2> av_mat_C_blocked(M, N, matC_blocked);
+  hc::array_view<float, 2> av_mat_C_packed(M, N, matC_packed);
+
+  gemm::pack_cache<float> cache;
+
+  auto blocked = [&]() {
+    gemm::blocked<float>(av_mat_A, av_weights, av_mat_C_blocked).wait();
+  };
+  auto packed = [&]() {
+    gemm::packed_matrix<float> packedA = gemm::pack_a<float>(av_mat_A);
+    const gemm::packed_matrix<float>& packedB = cache.b(weights.data(), av_weights);
+    gemm::blocked_packed<float>(packedA, packedB, av_mat_C_packed).wait();
+  };
+
+  // warm up, this also moves the data to the accelerator and packs the weights
+  blocked();
+  packed();
+
+  double seconds[2];
+  int which = 0;
+  for (auto f : { std::function<void()>(blocked), std::function<void()>(packed) }) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+      f();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    seconds[which++] = std::chrono::duration<double>(end - start).count() / ITERATIONS;
+  }
+
+  av_mat_C_blocked.synchronize();
+  av_mat_C_packed.synchronize();
+
+  int errors = 0;
+  for (int i = 0; i < M * N; i++) {
+    if (matC[i] != matC_blocked[i] || matC[i] != matC_packed[i])
+      errors++;
+  }
+
+  const double flop = 2.0 * M * N * K;
+  printf("%dx%dx%d  blocked %8.2f GFLOP/s  packed %8.2f GFLOP/s  %s\n", M, N, K
+         , flop / seconds[0] / 1.0e9, flop / seconds[1] / 1.0e9, errors ? "failed" : "passed");
+
+  return errors;
+}
@@ -3,6 +3,8 @@
 #include <random>
 #include <algorithm>
 #include <hc.hpp>
+#include "autotune.hpp"
+#include "wave_rotate_gemm.hpp"
 
 //#define DEBUG 1
 
@@ -20,23 +22,25 @@ void printMatrix(std::vector<int>& mat, const int M, const int N) {
 
 int main() {
 
-  constexpr int M_A = 128;
-  constexpr int N_A = 256;
+  // none of the dimensions need to be a multiple of the wavefront size
+  constexpr int M_A = 130;
+  constexpr int N_A = 250;
 
   constexpr int M_B = N_A;
-  constexpr int N_B = 512;
+  constexpr int N_B = 500;
 
   constexpr int M_C = M_A;
   constexpr int N_C = N_B;
 
-  constexpr int wave_size = 64;
-  static_assert(M_C%wave_size == 0,
-                "The number of columns in Matrix A needs to be a multiple of 64");
+  // adjacent output columns computed by each lane
+  constexpr int COLS = 4;
 
   std::vector<int> matA(M_A * N_A);
   std::vector<int> matB(M_B * N_B);
   std::vector<int> matC(M_C * N_C);
   std::vector<int> matC_gpu(M_C * N_C);
+  std::vector<int> matC_emulated(M_C * N_C);
+  std::vector<int> matC_emulated32(M_C * N_C);
 
   // initialize the input data
   std::default_random_engine random_gen;
@@ -58,34 +62,33 @@ int main() {
     }
   }
 
+  // run the wave rotate algorithm on the host with an emulated rotate, for 64 and
+  // 32-wide wavefronts
+  wave_rotate::wave_rotate_host<int, COLS, 64>(matA, matB, matC_emulated, M_C, N_C, N_A);
+  wave_rotate::wave_rotate_host<int, COLS, 32>(matA, matB, matC_emulated32, M_C, N_C, N_A);
+
   // create 2D array_views to present MxN matrices
-  hc::array_view<int, 2> av_mat_A(M_A, N_A, matA);
-  hc::array_view<int, 2> av_mat_B(M_B, N_B, matB);
+  hc::array_view<const int, 2> av_mat_A(M_A, N_A, matA);
+  hc::array_view<const int, 2> av_mat_B(M_B, N_B, matB);
   hc::array_view<int, 2> av_mat_C(hc::extent<2>(M_C, N_C), matC_gpu);
 
-  // Launch a MxN kernel with each work-item computing one element in the result matrix.
-  // Use a workgroup size equal to one wavefront.  Each workgroup would compute 
-  // 64 adjacent elements on the same row in the output matrix
-  hc::tiled_extent<2> t_extent = av_mat_C.get_extent().tile(1,wave_size);
-  
-  hc::parallel_for_each(t_extent, [=](hc::tiled_index<2> tidx) [[hc]] {
-    int p = 0;
-    for (int i = 0; i < N_A; i+=wave_size) {
-
-      // Each workitem within a group would load a different input element from the matrix A.
-      // Then after each iteration of the loop, we pass the data from matrix A
-      // to the adjacent workitem using a rotate to share that data within a group.
-      // After repeating this 64 times (size of a wave), the workgroup will move on to 
-      // the next block of 64 elements from matrix A. 
-      int vA = av_mat_A(tidx.global[0], i + tidx.local[1]);
-      for (int j = 0; j < wave_size; j++) {
-        int vB = av_mat_B(i + ((tidx.local[1] + j)%wave_size), tidx.global[1]);
-        p += vA * vB;
-        vA = hc::__amdgcn_wave_rl1(vA);
-      }
-    }
-    av_mat_C(tidx.global) = p;
-  });
+  // Each workgroup holds one wavefront per row and each lane computes COLS
+  // adjacent elements of its row, see wave_rotate_gemm.hpp.  The kernel is built
+  // for both wavefront sizes and the accelerator's wavefront size picks one.
+  printf("wavefront size: %d\n", wave::size());
+  auto matmul = [&](int rows) {
+    wave::dispatch(hc::accelerator(), [&](auto width) {
+      wave_rotate::wave_rotate<int, COLS, decltype(width)::value>(av_mat_A, av_mat_B, av_mat_C, rows).wait();
+    });
+  };
+
+  // pick the number of rows per workgroup, the choice is cached so later runs
+  // skip the measurement
+  autotune::tuner tuner("matmul_wave_rotate", hc::accelerator()
+                        , autotune::shape_bucket(M_C, N_C, N_A));
+  int rows = tuner.select({1, 2, 4, 8}, matmul);
+  printf("rows per workgroup: %d\n", rows);
+  matmul(rows);
 
   // synchronizes the results, which copies the data on the GPU
   // back to vector on the host
@@ -105,6 +108,12 @@ int main() {
   printMatrix(matC_gpu, M_C, N_C);
 #endif
 
+  bool verify_emulated = std::equal(matC.begin(), matC.end(), matC_emulated.begin());
+  printf("emulated: %s!\n", verify_emulated?"passed":"failed");
+
+  bool verify_emulated32 = std::equal(matC.begin(), matC.end(), matC_emulated32.begin());
+  printf("emulated wave32: %s!\n", verify_emulated32?"passed":"failed");
+
   bool verify = std::equal(matC.begin(), matC.end(), matC_gpu.begin());
   printf("%s!\n", verify?"passed":"failed");
 
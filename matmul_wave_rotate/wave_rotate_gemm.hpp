@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <hc.hpp>
+#include "wave.hpp"
+
+// Matrix multiply C = A * B (A MxK, B KxN, C MxN, row-major) that shares A
+// between the lanes of a wavefront with a rotate instead of memory.
+//
+// A workgroup is ROWS x Width work-items, one wavefront per row of C.  Each
+// lane loads one element of a Width wide slice of A's row, then Width times
+// multiplies it with the matching row of B and rotates it one lane to the left, so
+// every lane sees every element of the slice.  Each lane accumulates COLS adjacent
+// columns of C, which amortizes each rotate over COLS multiply-adds.
+//
+// Any M, N and K work: loads past the edges read zero and stores are predicated.
+// All lanes stay active to the end, since the rotate needs the whole wavefront.
+//
+// Width is the wavefront size of the accelerator the kernel runs on, 32 or 64; pick
+// it with wave::dispatch.
+//
+// wave_rotate_host runs the same algorithm on the CPU, one wavefront at a time with
+// the lanes held in an array, so the indexing can be checked without a GPU.
+
+namespace wave_rotate {
+
+// row of B (within the current slice) that lane uses at rotation step
+template <int Width>
+inline int slice_index(int lane, int step) [[cpu, hc]] {
+  return (lane + step) % Width;
+}
+
+// first column of C computed by lane of wavefront-column block
+template <int COLS, int Width>
+inline int first_column(int block, int lane) [[cpu, hc]] {
+  return (block * Width + lane) * COLS;
+}
+
+template <typename T, int COLS, int Width = wave::WAVE_SIZE>
+hc::completion_future wave_rotate(const hc::array_view<const T,2>& av_mat_A
+                                , const hc::array_view<const T,2>& av_mat_B
+                                , const hc::array_view<T,2>& av_mat_C
+                                , int rows) {
+  const int M = av_mat_C.get_extent()[0];
+  const int N = av_mat_C.get_extent()[1];
+  const int K = av_mat_A.get_extent()[1];
+
+  const int numBlocks = (N + Width * COLS - 1) / (Width * COLS);
+  hc::extent<2> grid(((M + rows - 1) / rows) * rows, numBlocks * Width);
+
+  av_mat_C.discard_data();
+  return hc::parallel_for_each(grid.tile(rows, Width), [=](hc::tiled_index<2> tidx) [[hc]] {
+    const int row = tidx.global[0];
+    const int lane = tidx.local[1];
+    const int col0 = first_column<COLS, Width>(tidx.tile[1], lane);
+    const bool rowValid = row < M;
+
+    T p[COLS];
+    for (int c = 0; c < COLS; c++)
+      p[c] = T(0);
+
+    for (int i = 0; i < K; i += Width) {
+      T vA = (rowValid && i + lane < K) ? av_mat_A(row, i + lane) : T(0);
+      for (int j = 0; j < Width; j++) {
+        int k = i + slice_index<Width>(lane, j);
+        if (k < K) {
+          for (int c = 0; c < COLS; c++) {
+            if (col0 + c < N)
+              p[c] += vA * av_mat_B(k, col0 + c);
+          }
+        }
+        vA = wave::rotate<1, Width>(vA);   // lane i gets lane i+1's value
+      }
+    }
+
+    if (rowValid) {
+      for (int c = 0; c < COLS; c++) {
+        if (col0 + c < N)
+          av_mat_C(row, col0 + c) = p[c];
+      }
+    }
+  });
+}
+
+template <typename T, int COLS, int Width = wave::WAVE_SIZE>
+void wave_rotate_host(const std::vector<T>& matA, const std::vector<T>& matB, std::vector<T>& matC
+                      , int M, int N, int K) {
+  const int numBlocks = (N + Width * COLS - 1) / (Width * COLS);
+
+  for (int row = 0; row < M; row++) {
+    for (int block = 0; block < numBlocks; block++) {
+
+      // one wavefront, lane by lane
+      T vA[Width];
+      T p[Width][COLS];
+      for (int lane = 0; lane < Width; lane++)
+        for (int c = 0; c < COLS; c++)
+          p[lane][c] = T(0);
+
+      for (int i = 0; i < K; i += Width) {
+        for (int lane = 0; lane < Width; lane++)
+          vA[lane] = (i + lane < K) ? matA[row * K + i + lane] : T(0);
+
+        for (int j = 0; j < Width; j++) {
+          for (int lane = 0; lane < Width; lane++) {
+            int k = i + slice_index<Width>(lane, j);
+            int col0 = first_column<COLS, Width>(block, lane);
+            if (k < K) {
+              for (int c = 0; c < COLS; c++) {
+                if (col0 + c < N)
+                  p[lane][c] += vA[lane] * matB[k * N + col0 + c];
+              }
+            }
+          }
+          wave::emulated::rotate<1>(vA);
+        }
+      }
+
+      for (int lane = 0; lane < Width; lane++) {
+        int col0 = first_column<COLS, Width>(block, lane);
+        for (int c = 0; c < COLS; c++) {
+          if (col0 + c < N)
+            matC[row * N + col0 + c] = p[lane][c];
+        }
+      }
+    }
+  }
+}
+
+} // namespace wave_rotate
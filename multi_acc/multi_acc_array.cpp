@@ -7,6 +7,8 @@
 
 // header file for the hc API
 #include <hc.hpp>
+#include "host_simd.hpp"
+#include "task_graph.hpp"
 
 int main() {
 
@@ -40,16 +42,21 @@ int main() {
   }
 
   constexpr int numViewPerAcc = 2;
-  int numSaxpyPerView = N/(accelerators.size() * numViewPerAcc);
+  // without an HSA accelerator the whole saxpy runs on the host below
+  int numSaxpyPerView = accelerators.empty() ? 0 : N/(accelerators.size() * numViewPerAcc);
 
   std::vector<hc::accelerator_view> acc_views;
 
-  std::vector<hc::completion_future> futures;
-
   std::vector<hc::array<float,1>> x_arrays;
   std::vector<hc::array<float,1>> y_arrays;
 
+  // the graph holds pointers into the arrays, so they must not move
+  x_arrays.reserve(accelerators.size() * numViewPerAcc);
+  y_arrays.reserve(accelerators.size() * numViewPerAcc);
 
+  // upload x and y, saxpy once both are there, download y;
+  // each accelerator_view runs its own chain independently of the others
+  task_graph::graph graph;
 
   int dataCursor = 0;
   for (auto acc = accelerators.begin(); acc != accelerators.end(); acc++) {
@@ -57,58 +64,48 @@ int main() {
 
       // create a new accelerator_view
       acc_views.push_back(acc->create_view());
+      auto& view = acc_views.back();
 
-      int newDataCursor = dataCursor+numSaxpyPerView;
-
-      // create array_views that only covers the data portion needed by this accelerator_view
-      x_arrays.push_back(hc::array<float,1>(numSaxpyPerView, acc_views.back()));
+      // create arrays that only cover the data portion needed by this accelerator_view
+      x_arrays.push_back(hc::array<float,1>(numSaxpyPerView, view));
+      y_arrays.push_back(hc::array<float,1>(numSaxpyPerView, view));
       auto& x_array = x_arrays.back();
+      auto& y_array = y_arrays.back();
+      const size_t bytes = numSaxpyPerView * sizeof(float);
 
-      hc::completion_future cpfuture_x = hc::copy_async(host_x.begin() + dataCursor
-                                                        , host_x.begin() + newDataCursor
-                                                        , x_array);
+      task_graph::task cp_x = graph.copy(view, x_array.accelerator_pointer()
+                                         , host_x.data() + dataCursor, bytes);
+      task_graph::task cp_y = graph.copy(view, y_array.accelerator_pointer()
+                                         , host_y.data() + dataCursor, bytes);
 
-      y_arrays.push_back(hc::array<float,1>(numSaxpyPerView, acc_views.back()));
-      auto& y_array = y_arrays.back();
+      // launched by submit(), after this loop, so look the arrays up by index
+      const size_t index = x_arrays.size() - 1;
+      task_graph::task saxpy = graph.kernel(view, [&,a,index](hc::accelerator_view& v) {
+        auto& x_array = x_arrays[index];
+        auto& y_array = y_arrays[index];
+        return hc::parallel_for_each(v, x_array.get_extent()
+                                   , [&,a](hc::index<1> i) [[hc]] {
+          y_array[i] = a * x_array[i] + y_array[i];
+        });
+      }, { cp_x, cp_y });
+
+      graph.copy(view, host_y.data() + dataCursor, y_array.accelerator_pointer(), bytes, { saxpy });
 
-      hc::completion_future cpfuture_y = hc::copy_async(host_y.begin() + dataCursor
-                                                        , host_y.begin() + newDataCursor
-                                                        , y_array);
-      dataCursor = newDataCursor;
-      cpfuture_x.wait();
-      cpfuture_y.wait();
-      
-      hc::completion_future f;
-      f = hc::parallel_for_each(acc_views.back(), x_array.get_extent()
-                            , [&,a](hc::index<1> i) [[hc]] {
-        y_array[i] = a * x_array[i] + y_array[i];
-      });
-      futures.push_back(f);
+      dataCursor += numSaxpyPerView;
 
       //printf("dataCursor: %d\n",dataCursor);
     }
   }
 
-  // If N is not a multiple of the number of acc_views,
-  // calculate the remaining saxpy on the host
-  for (; dataCursor!=N; dataCursor++) {
-    host_y[dataCursor] = a * host_x[dataCursor] + host_y[dataCursor];
-  }
+  // enqueue the whole graph, nothing waits on the host yet
+  graph.submit();
 
-  // synchronize all the results back to the host
-  auto kernel_future = futures.begin();
-  dataCursor = 0;
-  for(auto v = y_arrays.begin(); v != y_arrays.end(); v++) {
-    kernel_future->wait();
-    *kernel_future = hc::copy_async(*v, host_y.begin() + dataCursor);
-    dataCursor+=numSaxpyPerView;
-    kernel_future++;
-  }
+  // If N is not a multiple of the number of acc_views,
+  // calculate the remaining saxpy on the host with the SIMD host backend
+  host_simd::saxpy(N - dataCursor, a, host_x.data() + dataCursor, host_y.data() + dataCursor);
 
-  // wait for the copies to complete
-  for(auto f = futures.begin(); f != futures.end(); f++) {
-    f->wait();
-  }
+  // wait for the downloads, the only sinks of the graph
+  graph.wait();
  
   // verify the results
   int errors = 0;
@@ -0,0 +1,94 @@
+
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <string>
+
+// header file for the hc API
+#include <hc.hpp>
+#include "host_simd.hpp"
+#include "scheduler.hpp"
+
+int main() {
+
+  constexpr int N = 1024 * 1024 * 256;
+  constexpr float a = 100.0f;
+
+  // small enough that every worker gets many chunks, large enough to hide the launch overhead
+  constexpr int chunk = 1024 * 1024 * 4;
+  constexpr int numViewPerAcc = 2;
+  constexpr int iterations = 3;
+
+  std::vector<float> host_x(N);
+  std::vector<float> host_y_init(N);
+  std::vector<float> host_y(N);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-N, N);
+  std::generate(host_x.begin(), host_x.end(), [&]() { return distribution(random_gen); });
+  std::generate(host_y_init.begin(), host_y_init.end(), [&]() { return distribution(random_gen); });
+
+  // CPU implementation of saxpy
+  std::vector<float> host_result_y(N);
+  for (int i = 0; i < N; i++) {
+    host_result_y[i] = a * host_x[i] + host_y_init[i];
+  }
+
+  scheduler::work_stealing sched(chunk);
+
+  // one worker per accelerator_view, each launching saxpy on the chunks it pulls
+  std::vector<hc::accelerator> all_accelerators = hc::accelerator::get_all();
+  int numAcc = 0;
+  for (auto acc = all_accelerators.begin(); acc != all_accelerators.end(); acc++) {
+
+    // only pick accelerators supported by the HSA runtime
+    if (!acc->is_hsa_accelerator())
+      continue;
+
+    for (int i = 0; i < numViewPerAcc; i++) {
+      hc::accelerator_view view = acc->create_view();
+      sched.add_worker("acc" + std::to_string(numAcc) + "." + std::to_string(i)
+                       , [&, view](int begin, int end) {
+        hc::array_view<const float,1> x_av(end - begin, host_x.data() + begin);
+        hc::array_view<float,1> y_av(end - begin, host_y.data() + begin);
+        hc::parallel_for_each(view, y_av.get_extent()
+                              , [=](hc::index<1> i) [[hc]] {
+          y_av[i] = a * x_av[i] + y_av[i];
+        }).wait();
+        y_av.synchronize();
+      });
+    }
+    numAcc++;
+  }
+
+  // the host also pulls chunks, so it only takes as much as it can finish in time
+  sched.add_worker("host", [&](int begin, int end) {
+    host_simd::saxpy(end - begin, a, host_x.data() + begin, host_y.data() + begin);
+  });
+
+  // later iterations seed the queues from the throughput measured by earlier ones
+  int errors = 0;
+  for (int iter = 0; iter < iterations; iter++) {
+    std::copy(host_y_init.begin(), host_y_init.end(), host_y.begin());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    sched.run(N);
+    auto end = std::chrono::high_resolution_clock::now();
+    printf("iteration %d: %.3f s\n", iter, std::chrono::duration<double>(end - start).count());
+    sched.print_stats();
+
+    // verify the results
+    errors = 0;
+    for (int i = 0; i < N; i++) {
+      if (fabs(host_y[i] - host_result_y[i]) > fabs(host_result_y[i] * 0.0001f))
+        errors++;
+    }
+  }
+  std::cout << errors << " errors" << std::endl;
+
+  return errors;
+}
@@ -4,9 +4,12 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <string>
 
 // header file for the hc API
 #include <hc.hpp>
+#include "host_simd.hpp"
+#include "trace.hpp"
 
 int main() {
 
@@ -54,8 +57,9 @@ int main() {
     auto& x_av = x_views.back();
     auto& y_av = y_views.back();
     hc::completion_future f;
-    f = hc::parallel_for_each(acc_views.back(), x_av.get_extent()
-                          , [=](hc::index<1> i) [[hc]] {
+    f = trace::parallel_for_each("saxpy " + std::to_string(acc_views.size() - 1)
+                                , acc_views.back(), x_av.get_extent()
+                                , [=](hc::index<1> i) [[hc]] {
       y_av[i] = a * x_av[i] + y_av[i];
     });
     futures.push_back(f);
@@ -65,15 +69,22 @@ int main() {
   }
 
   // If N is not a multiple of the number of acc_views,
-  // calculate the remaining saxpy on the host
-  for (; dataCursor!=N; dataCursor++) {
-    host_y[dataCursor] = a * host_x[dataCursor] + host_y[dataCursor];
+  // calculate the remaining saxpy on the host with the SIMD host backend
+  {
+    trace::scope s("saxpy host");
+    host_simd::saxpy(N - dataCursor, a, host_x.data() + dataCursor, host_y.data() + dataCursor);
   }
 
   // synchronize all the results back to the host
-  for(auto v = y_views.begin(); v != y_views.end(); v++) {
-    v->synchronize();
+  {
+    trace::scope s("synchronize");
+    for(auto v = y_views.begin(); v != y_views.end(); v++) {
+      v->synchronize();
+    }
   }
+
+  // timeline of the kernels, if HC_TRACE names an output file
+  trace::write();
   
   // verify the results
   int errors = 0;
@@ -0,0 +1,683 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <hc.hpp>
+#include "hc_am.hpp"
+
+// Parallel algorithms that run on the accelerator when handed am_alloc'd memory.
+//
+//   float* x = hc::am_alloc(N * sizeof(float), AM_EXPLICIT_SYNC, acc_view);
+//   pstl::transform(pstl::par, x, x + N, y, y, [=](float x, float y) [[cpu, hc]] { return a * x + y; });
+//   float s = pstl::reduce(pstl::par, y, y + N);
+//
+// Every algorithm checks each of its ranges with am_get_pointer_info.  If all of them
+// lie in device memory from am_alloc the work runs as tiled kernels on the default
+// accelerator_view, otherwise it runs on host threads; device memory only reaches the
+// device side through raw pointers.  When some ranges of a call are on the device and
+// some on the host, the device ones are copied to host buffers, the call runs on the
+// host and the outputs are copied back.  Functors run on both sides, so they need to
+// be [[cpu, hc]].
+//
+//   for_each, transform          one work-item per element
+//   transform_reduce, reduce     grid-stride loop, tile tree in tile_static memory,
+//                                tile partials folded on the host in tile order
+//   inclusive_scan,              tile scans, a scan of the tile totals, then
+//   exclusive_scan               a pass adding each tile's prefix
+//   sort                         bitonic network, ascending comparators only, so
+//                                it works for any length without padding; steps
+//                                within 2 * TILE elements run in tile_static memory
+//   copy_if                      flags, exclusive scan of the flags, scatter
+//
+// Reductions and scans need an associative op but no identity element.  pstl::seq
+// runs the same calls sequentially on the host, for reference.
+
+namespace pstl {
+
+struct sequenced_policy {};
+struct parallel_policy {};
+
+constexpr sequenced_policy seq = {};
+constexpr parallel_policy par = {};
+
+template <typename T = void>
+struct plus {
+  template <typename A, typename B>
+  auto operator()(const A& a, const B& b) const [[cpu, hc]] -> decltype(a + b) { return a + b; }
+};
+
+template <typename T = void>
+struct less {
+  template <typename A, typename B>
+  bool operator()(const A& a, const B& b) const [[cpu, hc]] { return a < b; }
+};
+
+struct identity {
+  template <typename A>
+  A operator()(const A& a) const [[cpu, hc]] { return a; }
+};
+
+namespace detail {
+
+constexpr int TILE = 256;
+constexpr int MAX_TILES = 1024;
+
+// below this many elements a kernel launch costs more than it saves
+constexpr long SMALL = TILE * 4;
+
+// most work-items in one launch, extents are int
+constexpr long LAUNCH = 1L << 30;
+
+template <typename T>
+bool on_device(T* p) {
+  am_pointer_info_t info;
+  return hc::am_get_pointer_info(p, &info) == AM_SUCCESS && !info.is_host_memory;
+}
+
+template <typename It>
+bool on_device(It) { return false; }
+
+enum side { HOST, DEVICE, MIXED };
+
+// where the ranges starting at its are
+template <typename... Its>
+side placement(Its... its) {
+  const bool device[] = { on_device(its)... };
+  bool all = true, any = false;
+  for (bool d : device) {
+    all = all && d;
+    any = any || d;
+  }
+  return all ? DEVICE : any ? MIXED : HOST;
+}
+
+// Host access to one range of a call whose ranges are on different sides.  Host
+// ranges are used in place.  A device range is copied to a host buffer if read is
+// set, and store(count) copies the first count elements back.
+template <typename It>
+class host_range {
+public:
+  host_range(It first, long, bool) : _first(first) {}
+  It begin() const { return _first; }
+  void store(long) {}
+private:
+  It _first;
+};
+
+template <typename T>
+class host_range<T*> {
+public:
+  typedef typename std::remove_const<T>::type value_type;
+
+  host_range(T* first, long n, bool read) : _device(NULL), _first(first) {
+    if (on_device(first)) {
+      _device = first;
+      _buffer.resize(n);
+      if (read) hc::am_copy(_buffer.data(), first, n * sizeof(T));
+      _first = _buffer.data();
+    }
+  }
+  T* begin() const { return _first; }
+  void store(long count) {
+    if (_device != NULL && count > 0)
+      hc::am_copy(const_cast<value_type*>(_device), _buffer.data(), count * sizeof(T));
+  }
+private:
+  T* _device;
+  T* _first;
+  std::vector<value_type> _buffer;
+};
+
+template <typename T>
+T* device_alloc(long n) {
+  return static_cast<T*>(static_cast<void*>(hc::am_alloc(n * sizeof(T), AM_EXPLICIT_SYNC
+                                                         , hc::accelerator().get_default_view())));
+}
+
+//---
+// Host side: the range is split in one part per hardware thread.
+
+inline int host_parts(long n) {
+  long threads = std::max(1u, std::thread::hardware_concurrency());
+  return int(std::max(1L, std::min(threads, n / 4096)));
+}
+
+// f(part, begin, end) for each part, in parallel
+template <typename F>
+void host_parallel(long n, int parts, F f) {
+  if (parts <= 1) {
+    f(0, 0L, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (int p = 0; p < parts; p++) {
+    workers.push_back(std::thread(f, p, n * p / parts, n * (p + 1) / parts));
+  }
+  for (auto& w : workers) w.join();
+}
+
+//---
+// Device side
+//
+// Every launch goes to the default accelerator_view, which runs them in order, so
+// waiting for the last launch of a sequence waits for all of them.
+
+// f(i) for every i in [0, n), in as many launches as the int extents need
+template <typename F>
+hc::completion_future device_for(long n, F f) {
+  hc::completion_future done;
+  for (long first = 0; first < n; first += LAUNCH) {
+    const int count = int(std::min(LAUNCH, n - first));
+    done = hc::parallel_for_each(hc::extent<1>(count), [=](hc::index<1> i) [[hc]] {
+      f(first + i[0]);
+    });
+  }
+  return done;
+}
+
+// f(tidx, tile) for numTiles tiles of TILE work-items, tile being the tile's index
+// over all launches
+template <typename F>
+hc::completion_future device_for_tiles(long numTiles, F f) {
+  hc::completion_future done;
+  for (long first = 0; first < numTiles; first += LAUNCH / TILE) {
+    const int count = int(std::min(LAUNCH / TILE, numTiles - first));
+    hc::extent<1> e(count * TILE);
+    done = hc::parallel_for_each(e.tile(TILE), [=](hc::tiled_index<1> tidx) [[hc]] {
+      f(tidx, first + tidx.tile[0]);
+    });
+  }
+  return done;
+}
+
+// out = inclusive scan of in, out may be in; every tile is one TILE-wide slice
+template <typename T, typename Op>
+void device_inclusive_scan(const T* in, long n, T* out, Op op);
+
+template <typename T, typename Op>
+void device_scan_tiles(const T* in, long n, T* out, T* sums, Op op) {
+  const long numTiles = (n + TILE - 1) / TILE;
+  device_for_tiles(numTiles, [=](hc::tiled_index<1>& tidx, long tile) [[hc]] {
+    tile_static T s[TILE];
+    const int l = tidx.local[0];
+    const long i = tile * TILE + l;
+    const long left = n - tile * TILE;
+    const int count = (left < TILE) ? int(left) : TILE;
+    if (l < count) s[l] = in[i];
+    tidx.barrier.wait();
+
+    // Hillis-Steele: after step d, s[l] holds the scan of (l - 2d, l]
+    for (int d = 1; d < count; d *= 2) {
+      T v = s[l];
+      if (l >= d && l < count) v = op(s[l - d], v);
+      tidx.barrier.wait();
+      s[l] = v;
+      tidx.barrier.wait();
+    }
+
+    if (l < count) out[i] = s[l];
+    if (l == count - 1) sums[tile] = s[l];
+  }).wait();
+}
+
+template <typename T, typename Op>
+void device_inclusive_scan(const T* in, long n, T* out, Op op) {
+  const long numTiles = (n + TILE - 1) / TILE;
+  T* sums = device_alloc<T>(numTiles);
+  device_scan_tiles(in, n, out, sums, op);
+
+  if (numTiles > 1) {
+    // prefix of every tile: scan the tile totals, on the device if there are many
+    if (numTiles > SMALL) {
+      device_inclusive_scan(sums, numTiles, sums, op);
+    }
+    else {
+      std::vector<T> h(numTiles);
+      hc::am_copy(h.data(), sums, numTiles * sizeof(T));
+      for (long t = 1; t < numTiles; t++) h[t] = op(h[t - 1], h[t]);
+      hc::am_copy(sums, h.data(), numTiles * sizeof(T));
+    }
+
+    device_for(n - TILE, [=](long j) [[hc]] {
+      const long i = j + TILE;
+      out[i] = op(sums[i / TILE - 1], out[i]);
+    }).wait();
+  }
+  hc::am_free(sums);
+}
+
+// Bitonic steps of merge sizes k0, 2 * k0, ... k1 (k1 <= 2 * TILE, or k0 == k1) with
+// pair distance d <= TILE.  Their pairs never leave a block of 2 * TILE elements, so
+// each tile loads one block into tile_static memory and runs all those steps there.
+template <typename T, typename Comp>
+hc::completion_future device_sort_block(T* p, long n, long k0, long k1, Comp comp) {
+  const long blocks = (n + 2 * TILE - 1) / (2 * TILE);
+  return device_for_tiles(blocks, [=](hc::tiled_index<1>& tidx, long block) [[hc]] {
+    tile_static T s[2 * TILE];
+    const int l = tidx.local[0];
+    const long base = block * 2 * TILE;
+    const long left = n - base;
+    const int count = (left < 2 * TILE) ? int(left) : 2 * TILE;
+    if (l < count) s[l] = p[base + l];
+    if (l + TILE < count) s[l + TILE] = p[base + l + TILE];
+    tidx.barrier.wait();
+
+    for (long k = k0; k <= k1; k *= 2) {
+      for (int d = (k / 2 < TILE) ? int(k / 2) : TILE; d >= 1; d /= 2) {
+        // base is a multiple of k, so the flip stays inside the block
+        const int i = (l / d) * 2 * d + (l % d);
+        const int j = (d == k / 2) ? int(i ^ (k - 1)) : i + d;
+        if (j < count && comp(s[j], s[i])) {
+          T tmp = s[i];
+          s[i] = s[j];
+          s[j] = tmp;
+        }
+        tidx.barrier.wait();
+      }
+    }
+
+    if (l < count) p[base + l] = s[l];
+    if (l + TILE < count) p[base + l + TILE] = s[l + TILE];
+  });
+}
+
+// sort [p, p + n) with the bitonic network.  Steps with d <= TILE run in
+// device_sort_block, the others as one launch each; nothing waits until the end.
+template <typename T, typename Comp>
+void device_sort(T* p, long n, Comp comp) {
+  long size = 1;
+  while (size < n) size *= 2;
+
+  const long half = size / 2;
+  hc::completion_future done = device_sort_block(p, n, 2, std::min(size, 2L * TILE), comp);
+  for (long k = 4L * TILE; k <= size; k *= 2) {
+    for (long d = k / 2; d > TILE; d /= 2) {
+      const bool flip = (d == k / 2);
+      // one work-item per comparator: i is the lower index of the pair
+      done = device_for(half, [=](long t) [[hc]] {
+        const long i = (t / d) * 2 * d + (t % d);
+        const long j = flip ? (i ^ (k - 1)) : i + d;
+        if (j < n && comp(p[j], p[i])) {
+          T tmp = p[i];
+          p[i] = p[j];
+          p[j] = tmp;
+        }
+      });
+    }
+    done = device_sort_block(p, n, k, k, comp);
+  }
+  done.wait();
+}
+
+} // namespace detail
+
+
+//---
+// for_each, transform
+
+template <typename It, typename F>
+void for_each(sequenced_policy, It first, It last, F f) {
+  std::for_each(first, last, f);
+}
+
+template <typename It, typename F>
+void for_each(parallel_policy, It first, It last, F f) {
+  const long n = std::distance(first, last);
+  if (n == 0) return;
+  if (detail::on_device(first)) {
+    auto p = &*first;
+    detail::device_for(n, [=](long i) [[hc]] {
+      f(p[i]);
+    }).wait();
+    return;
+  }
+  detail::host_parallel(n, detail::host_parts(n), [&](int, long b, long e) {
+    std::for_each(first + b, first + e, f);
+  });
+}
+
+template <typename It, typename Out, typename F>
+Out transform(sequenced_policy, It first, It last, Out out, F f) {
+  return std::transform(first, last, out, f);
+}
+
+template <typename It, typename Out, typename F>
+Out transform(parallel_policy, It first, It last, Out out, F f) {
+  const long n = std::distance(first, last);
+  if (n == 0) return out;
+  const detail::side side = detail::placement(first, out);
+  if (side == detail::DEVICE) {
+    auto in = &*first;
+    auto o = &*out;
+    detail::device_for(n, [=](long i) [[hc]] {
+      o[i] = f(in[i]);
+    }).wait();
+    return out + n;
+  }
+  if (side == detail::MIXED) {
+    detail::host_range<It> in(first, n, true);
+    detail::host_range<Out> o(out, n, false);
+    transform(par, in.begin(), in.begin() + n, o.begin(), f);
+    o.store(n);
+    return out + n;
+  }
+  detail::host_parallel(n, detail::host_parts(n), [&](int, long b, long e) {
+    std::transform(first + b, first + e, out + b, f);
+  });
+  return out + n;
+}
+
+template <typename It1, typename It2, typename Out, typename F>
+Out transform(sequenced_policy, It1 first1, It1 last1, It2 first2, Out out, F f) {
+  return std::transform(first1, last1, first2, out, f);
+}
+
+template <typename It1, typename It2, typename Out, typename F>
+Out transform(parallel_policy, It1 first1, It1 last1, It2 first2, Out out, F f) {
+  const long n = std::distance(first1, last1);
+  if (n == 0) return out;
+  const detail::side side = detail::placement(first1, first2, out);
+  if (side == detail::DEVICE) {
+    auto in1 = &*first1;
+    auto in2 = &*first2;
+    auto o = &*out;
+    detail::device_for(n, [=](long i) [[hc]] {
+      o[i] = f(in1[i], in2[i]);
+    }).wait();
+    return out + n;
+  }
+  if (side == detail::MIXED) {
+    detail::host_range<It1> in1(first1, n, true);
+    detail::host_range<It2> in2(first2, n, true);
+    detail::host_range<Out> o(out, n, false);
+    transform(par, in1.begin(), in1.begin() + n, in2.begin(), o.begin(), f);
+    o.store(n);
+    return out + n;
+  }
+  detail::host_parallel(n, detail::host_parts(n), [&](int, long b, long e) {
+    std::transform(first1 + b, first1 + e, first2 + b, out + b, f);
+  });
+  return out + n;
+}
+
+
+//---
+// transform_reduce, reduce
+
+template <typename It, typename T, typename Reduce, typename Transform>
+T transform_reduce(sequenced_policy, It first, It last, T init, Reduce reduce, Transform transform) {
+  for (; first != last; ++first) init = reduce(init, transform(*first));
+  return init;
+}
+
+template <typename It, typename T, typename Reduce, typename Transform>
+T transform_reduce(parallel_policy, It first, It last, T init, Reduce reduce, Transform transform) {
+  using detail::TILE;
+  const long n = std::distance(first, last);
+
+  if (detail::on_device(first) && n >= detail::SMALL) {
+    auto in = &*first;
+
+    // every work-item gets at least one element, so no identity is needed
+    const int numTiles = int(std::min<long>(detail::MAX_TILES, n / TILE));
+    const long numThreads = long(numTiles) * TILE;
+    T* partials = detail::device_alloc<T>(numTiles);
+
+    hc::extent<1> e(static_cast<int>(numThreads));
+    hc::parallel_for_each(e.tile(TILE), [=](hc::tiled_index<1> tidx) [[hc]] {
+      tile_static T s[TILE];
+      const int l = tidx.local[0];
+      long i = tidx.global[0];
+      T v = transform(in[i]);
+      for (i += numThreads; i < n; i += numThreads) {
+        v = reduce(v, transform(in[i]));
+      }
+      s[l] = v;
+      tidx.barrier.wait();
+      for (int d = TILE / 2; d > 0; d /= 2) {
+        if (l < d) s[l] = reduce(s[l], s[l + d]);
+        tidx.barrier.wait();
+      }
+      if (l == 0) partials[tidx.tile[0]] = s[0];
+    }).wait();
+
+    std::vector<T> h(numTiles);
+    hc::am_copy(h.data(), partials, numTiles * sizeof(T));
+    hc::am_free(partials);
+    for (int t = 0; t < numTiles; t++) init = reduce(init, h[t]);
+    return init;
+  }
+
+  if (detail::on_device(first)) {
+    // too small for a launch: fetch it and reduce on the host
+    std::vector<typename std::iterator_traits<It>::value_type> h(n);
+    hc::am_copy(h.data(), &*first, n * sizeof(h[0]));
+    return transform_reduce(seq, h.begin(), h.end(), init, reduce, transform);
+  }
+
+  const int parts = detail::host_parts(n);
+  std::vector<T> partials(parts);
+  std::vector<char> nonEmpty(parts, 0);
+  detail::host_parallel(n, parts, [&](int p, long b, long e) {
+    if (b == e) return;
+    T v = transform(first[b]);
+    for (long i = b + 1; i < e; i++) v = reduce(v, transform(first[i]));
+    partials[p] = v;
+    nonEmpty[p] = 1;
+  });
+  for (int p = 0; p < parts; p++) {
+    if (nonEmpty[p]) init = reduce(init, partials[p]);
+  }
+  return init;
+}
+
+template <typename Policy, typename It, typename T, typename Op>
+T reduce(Policy policy, It first, It last, T init, Op op) {
+  return transform_reduce(policy, first, last, init, op, identity());
+}
+
+template <typename Policy, typename It>
+typename std::iterator_traits<It>::value_type reduce(Policy policy, It first, It last) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  return transform_reduce(policy, first, last, T(0), plus<T>(), identity());
+}
+
+
+//---
+// inclusive_scan, exclusive_scan
+
+template <typename It, typename Out, typename Op>
+Out inclusive_scan(sequenced_policy, It first, It last, Out out, Op op) {
+  return std::partial_sum(first, last, out, op);
+}
+
+template <typename It, typename Out, typename Op>
+Out inclusive_scan(parallel_policy, It first, It last, Out out, Op op) {
+  const long n = std::distance(first, last);
+  if (n == 0) return out;
+  const detail::side side = detail::placement(first, out);
+  if (side == detail::DEVICE) {
+    detail::device_inclusive_scan(&*first, n, &*out, op);
+    return out + n;
+  }
+  if (side == detail::MIXED) {
+    detail::host_range<It> in(first, n, true);
+    detail::host_range<Out> o(out, n, false);
+    inclusive_scan(par, in.begin(), in.begin() + n, o.begin(), op);
+    o.store(n);
+    return out + n;
+  }
+
+  // scan every part, then add the total of the parts before it
+  typedef typename std::decay<decltype(op(*first, *first))>::type V;
+  const int parts = detail::host_parts(n);
+  detail::host_parallel(n, parts, [&](int, long b, long e) {
+    std::partial_sum(first + b, first + e, out + b, op);
+  });
+  std::vector<V> carry(parts);
+  for (int p = 1; p < parts; p++) {
+    V last = out[n * p / parts - 1];
+    carry[p] = (p == 1) ? last : op(carry[p - 1], last);
+  }
+  detail::host_parallel(n, parts, [&](int p, long b, long e) {
+    if (p == 0) return;
+    for (long i = b; i < e; i++) out[i] = op(carry[p], out[i]);
+  });
+  return out + n;
+}
+
+template <typename Policy, typename It, typename Out>
+Out inclusive_scan(Policy policy, It first, It last, Out out) {
+  return inclusive_scan(policy, first, last, out, plus<>());
+}
+
+template <typename It, typename Out, typename T, typename Op>
+Out exclusive_scan(sequenced_policy, It first, It last, Out out, T init, Op op) {
+  for (; first != last; ++first, ++out) {
+    T v = *first;
+    *out = init;
+    init = op(init, v);
+  }
+  return out;
+}
+
+template <typename It, typename Out, typename T, typename Op>
+Out exclusive_scan(parallel_policy policy, It first, It last, Out out, T init, Op op) {
+  const long n = std::distance(first, last);
+  if (n == 0) return out;
+  const detail::side side = detail::placement(first, out);
+  if (side == detail::DEVICE) {
+    T* inclusive = detail::device_alloc<T>(n);
+    detail::device_inclusive_scan(&*first, n, inclusive, op);
+    auto o = &*out;
+    detail::device_for(n, [=](long i) [[hc]] {
+      o[i] = (i == 0) ? init : op(init, inclusive[i - 1]);
+    }).wait();
+    hc::am_free(inclusive);
+    return out + n;
+  }
+  if (side == detail::MIXED) {
+    detail::host_range<It> in(first, n, true);
+    detail::host_range<Out> o(out, n, false);
+    exclusive_scan(policy, in.begin(), in.begin() + n, o.begin(), init, op);
+    o.store(n);
+    return out + n;
+  }
+
+  std::vector<T> inclusive(n);
+  inclusive_scan(policy, first, last, inclusive.begin(), op);
+  detail::host_parallel(n, detail::host_parts(n), [&](int, long b, long e) {
+    for (long i = b; i < e; i++) out[i] = (i == 0) ? init : op(init, inclusive[i - 1]);
+  });
+  return out + n;
+}
+
+template <typename Policy, typename It, typename Out, typename T>
+Out exclusive_scan(Policy policy, It first, It last, Out out, T init) {
+  return exclusive_scan(policy, first, last, out, init, plus<>());
+}
+
+
+//---
+// sort
+
+template <typename It, typename Comp>
+void sort(sequenced_policy, It first, It last, Comp comp) {
+  std::sort(first, last, comp);
+}
+
+template <typename It, typename Comp>
+void sort(parallel_policy, It first, It last, Comp comp) {
+  const long n = std::distance(first, last);
+  if (n < 2) return;
+  if (detail::on_device(first)) {
+    detail::device_sort(&*first, n, comp);
+    return;
+  }
+
+  // sort the parts, then merge neighbours pairwise until one run is left
+  const int parts = detail::host_parts(n);
+  detail::host_parallel(n, parts, [&](int, long b, long e) {
+    std::sort(first + b, first + e, comp);
+  });
+  for (int width = 1; width < parts; width *= 2) {
+    const int merges = (parts + 2 * width - 1) / (2 * width);
+    std::vector<std::thread> workers;
+    for (int m = 0; m < merges; m++) {
+      long b = n * (2 * m * width) / parts;
+      long mid = n * std::min(parts, (2 * m + 1) * width) / parts;
+      long e = n * std::min(parts, (2 * m + 2) * width) / parts;
+      workers.push_back(std::thread([=]() { std::inplace_merge(first + b, first + mid, first + e, comp); }));
+    }
+    for (auto& w : workers) w.join();
+  }
+}
+
+template <typename Policy, typename It>
+void sort(Policy policy, It first, It last) {
+  sort(policy, first, last, less<>());
+}
+
+
+//---
+// copy_if
+
+template <typename It, typename Out, typename Pred>
+Out copy_if(sequenced_policy, It first, It last, Out out, Pred pred) {
+  return std::copy_if(first, last, out, pred);
+}
+
+template <typename It, typename Out, typename Pred>
+Out copy_if(parallel_policy, It first, It last, Out out, Pred pred) {
+  const long n = std::distance(first, last);
+  if (n == 0) return out;
+
+  const detail::side side = detail::placement(first, out);
+  if (side == detail::DEVICE) {
+    auto in = &*first;
+    auto o = &*out;
+    // positions may pass 2^31
+    long* flags = detail::device_alloc<long>(n);
+    long* positions = detail::device_alloc<long>(n);
+
+    detail::device_for(n, [=](long i) [[hc]] {
+      flags[i] = pred(in[i]) ? 1 : 0;
+    }).wait();
+    exclusive_scan(par, flags, flags + n, positions, 0L);
+    detail::device_for(n, [=](long i) [[hc]] {
+      if (flags[i]) o[positions[i]] = in[i];
+    }).wait();
+
+    long last_flag, last_position;
+    hc::am_copy(&last_flag, flags + n - 1, sizeof(long));
+    hc::am_copy(&last_position, positions + n - 1, sizeof(long));
+    hc::am_free(flags);
+    hc::am_free(positions);
+    return out + (last_position + last_flag);
+  }
+  if (side == detail::MIXED) {
+    // out may be shorter than the input, only the copied elements go back
+    detail::host_range<It> in(first, n, true);
+    detail::host_range<Out> o(out, n, false);
+    const long count = copy_if(par, in.begin(), in.begin() + n, o.begin(), pred) - o.begin();
+    o.store(count);
+    return out + count;
+  }
+
+  // count per part, then every part copies to its own offset
+  const int parts = detail::host_parts(n);
+  std::vector<long> counts(parts + 1, 0);
+  detail::host_parallel(n, parts, [&](int p, long b, long e) {
+    counts[p + 1] = std::count_if(first + b, first + e, pred);
+  });
+  std::partial_sum(counts.begin(), counts.end(), counts.begin());
+  detail::host_parallel(n, parts, [&](int p, long b, long e) {
+    std::copy_if(first + b, first + e, out + counts[p], pred);
+  });
+  return out + counts[parts];
+}
+
+} // namespace pstl
@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+// header file for the hc API
+#include <hc.hpp>
+#include "hc_am.hpp"
+#include "algorithm.hpp"
+
+// Runs every pstl algorithm on am_alloc'd memory, where it goes to the accelerator,
+// and on std::vector memory, where it goes to host threads, and compares both
+// against the sequential std algorithm.
+
+#define N  (1024 * 1024 + 3)
+
+int errors = 0;
+
+void check(const char* name, bool ok) {
+  printf("%-20s %s\n", name, ok ? "passed" : "failed");
+  if (!ok) errors++;
+}
+
+int main() {
+
+  const float a = 100.0f;
+
+  std::vector<float> x(N);
+  std::vector<float> y(N);
+  std::vector<int> keys(N);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> key_distribution(-1000, 1000);
+  std::generate(x.begin(), x.end(), [&]() { return distribution(random_gen); });
+  std::generate(y.begin(), y.end(), [&]() { return distribution(random_gen); });
+  std::generate(keys.begin(), keys.end(), [&]() { return key_distribution(random_gen); });
+
+  hc::accelerator_view acc_view = hc::accelerator().get_default_view();
+  float* x_gpu = hc::am_alloc(N * sizeof(float), AM_EXPLICIT_SYNC, acc_view);
+  float* y_gpu = hc::am_alloc(N * sizeof(float), AM_EXPLICIT_SYNC, acc_view);
+  int* keys_gpu = hc::am_alloc(N * sizeof(int), AM_EXPLICIT_SYNC, acc_view);
+  int* out_gpu = hc::am_alloc(N * sizeof(int), AM_EXPLICIT_SYNC, acc_view);
+  hc::am_copy(x_gpu, x.data(), N * sizeof(float));
+  hc::am_copy(keys_gpu, keys.data(), N * sizeof(int));
+
+  // fetch n elements of device memory
+  auto fetch = [](const int* p, int n) {
+    std::vector<int> h(n);
+    hc::am_copy(h.data(), p, n * sizeof(int));
+    return h;
+  };
+
+  // saxpy with transform
+  {
+    std::vector<float> expected(N), host(N), device(N);
+    std::transform(x.begin(), x.end(), y.begin(), expected.begin(), [=](float x, float y) { return a * x + y; });
+
+    hc::am_copy(y_gpu, y.data(), N * sizeof(float));
+    pstl::transform(pstl::par, x_gpu, x_gpu + N, y_gpu, y_gpu, [=](float x, float y) [[cpu, hc]] { return a * x + y; });
+    hc::am_copy(device.data(), y_gpu, N * sizeof(float));
+    pstl::transform(pstl::par, x.begin(), x.end(), y.begin(), host.begin(), [=](float x, float y) [[cpu, hc]] { return a * x + y; });
+
+    bool ok = true;
+    for (int i = 0; i < N; i++) {
+      ok = ok && fabs(device[i] - expected[i]) <= fabs(expected[i] * 0.0001f) && host[i] == expected[i];
+    }
+    check("transform", ok);
+  }
+
+  // for_each
+  {
+    std::vector<int> expected(keys), host(keys);
+    std::for_each(expected.begin(), expected.end(), [](int& k) { k *= 3; });
+    pstl::for_each(pstl::par, host.begin(), host.end(), [](int& k) [[cpu, hc]] { k *= 3; });
+    hc::am_copy(out_gpu, keys.data(), N * sizeof(int));
+    pstl::for_each(pstl::par, out_gpu, out_gpu + N, [](int& k) [[cpu, hc]] { k *= 3; });
+    check("for_each", fetch(out_gpu, N) == expected && host == expected);
+  }
+
+  // sum of squares with transform_reduce, exact on integers
+  {
+    auto square = [](int k) [[cpu, hc]] { return (long long)k * k; };
+    long long expected = 0;
+    for (int k : keys) expected += (long long)k * k;
+    long long device = pstl::transform_reduce(pstl::par, keys_gpu, keys_gpu + N, 0LL, pstl::plus<>(), square);
+    long long host = pstl::transform_reduce(pstl::par, keys.begin(), keys.end(), 0LL, pstl::plus<>(), square);
+    check("transform_reduce", device == expected && host == expected);
+    check("reduce", pstl::reduce(pstl::par, keys_gpu, keys_gpu + N) == std::accumulate(keys.begin(), keys.end(), 0));
+  }
+
+  // scans
+  {
+    std::vector<int> expected(N), host(N);
+    std::partial_sum(keys.begin(), keys.end(), expected.begin());
+    pstl::inclusive_scan(pstl::par, keys_gpu, keys_gpu + N, out_gpu);
+    pstl::inclusive_scan(pstl::par, keys.begin(), keys.end(), host.begin());
+    check("inclusive_scan", fetch(out_gpu, N) == expected && host == expected);
+
+    pstl::exclusive_scan(pstl::seq, keys.begin(), keys.end(), expected.begin(), 7, pstl::plus<>());
+    pstl::exclusive_scan(pstl::par, keys_gpu, keys_gpu + N, out_gpu, 7);
+    pstl::exclusive_scan(pstl::par, keys.begin(), keys.end(), host.begin(), 7);
+    check("exclusive_scan", fetch(out_gpu, N) == expected && host == expected);
+  }
+
+  // copy_if
+  {
+    auto positive = [](int k) [[cpu, hc]] { return k > 0; };
+    std::vector<int> expected, host(N);
+    std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected), positive);
+    int* device_end = pstl::copy_if(pstl::par, keys_gpu, keys_gpu + N, out_gpu, positive);
+    auto host_end = pstl::copy_if(pstl::par, keys.begin(), keys.end(), host.begin(), positive);
+    host.resize(host_end - host.begin());
+    check("copy_if", fetch(out_gpu, int(device_end - out_gpu)) == expected && host == expected);
+  }
+
+  // sort
+  {
+    std::vector<int> expected(keys), host(keys);
+    std::sort(expected.begin(), expected.end());
+    pstl::sort(pstl::par, keys_gpu, keys_gpu + N);
+    pstl::sort(pstl::par, host.begin(), host.end());
+    check("sort", fetch(keys_gpu, N) == expected && host == expected);
+  }
+
+  hc::am_free(x_gpu);
+  hc::am_free(y_gpu);
+  hc::am_free(keys_gpu);
+  hc::am_free(out_gpu);
+
+  return errors;
+}
@@ -0,0 +1,97 @@
+#include <vector>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+// header file for the hc API
+#include <hc.hpp>
+#include "hc_am.hpp"
+
+// Measure am_get_pointer_info throughput with many live allocations.
+// Every lookup uses a pointer into the middle of an allocation.  The cost of
+// am_alloc and am_free, which insert into and erase from the tracker, is
+// reported for each number of live allocations as well.
+
+#define BLOCK_SIZE        256
+#define LOOKUPS_PER_THREAD (1024 * 1024)
+
+template <typename F>
+double seconds(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  return elapsed.count();
+}
+
+double lookup_rate(const std::vector<char*>& blocks, int num_threads) {
+
+  std::vector<std::thread> threads;
+  std::vector<int> misses(num_threads, 0);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.push_back(std::thread([&, t]() {
+      std::default_random_engine random_gen(t);
+      std::uniform_int_distribution<size_t> pick(0, blocks.size() - 1);
+      std::uniform_int_distribution<size_t> offset(0, BLOCK_SIZE - 1);
+      am_pointer_info_t info;
+      for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+        char* p = blocks[pick(random_gen)] + offset(random_gen);
+        if (hc::am_get_pointer_info(p, &info) != AM_SUCCESS)
+          misses[t]++;
+      }
+    }));
+  }
+  for (auto& t : threads)
+    t.join();
+  auto end = std::chrono::high_resolution_clock::now();
+
+  for (int t = 0; t < num_threads; t++) {
+    if (misses[t] != 0)
+      printf("error: %d lookups missed\n", misses[t]);
+  }
+
+  std::chrono::duration<double> elapsed = end - start;
+  return (double)num_threads * LOOKUPS_PER_THREAD / elapsed.count() / 1.0e6;
+}
+
+int main() {
+
+  hc::accelerator_view acc_view = hc::accelerator().get_default_view();
+  const int max_threads = std::thread::hardware_concurrency();
+
+  printf("%10s %8s %14s %14s %14s\n", "live", "threads", "Mlookups/s", "alloc (ns)", "free (ns)");
+  for (int live = 1000; live <= 1000 * 1000; live *= 10) {
+
+    // the first round fills the pool, the second one allocates from it, so its
+    // time is mostly the tracker insert
+    std::vector<char*> blocks(live);
+    double alloc_s = 0.0;
+    double free_s = 0.0;
+    for (int round = 0; round < 2; round++) {
+      alloc_s = seconds([&]() {
+        for (int i = 0; i < live; i++)
+          blocks[i] = hc::am_alloc(BLOCK_SIZE, AM_EXPLICIT_SYNC, acc_view);
+      });
+      if (round == 1)
+        break;
+      free_s = seconds([&]() {
+        for (auto p : blocks)
+          hc::am_free(p);
+      });
+    }
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      printf("%10d %8d %14.2f %14.1f %14.1f\n", live, threads, lookup_rate(blocks, threads)
+             , alloc_s / live * 1.0e9, free_s / live * 1.0e9);
+    }
+
+    for (auto p : blocks)
+      hc::am_free(p);
+    hc::am_pool_trim();
+  }
+
+  return 0;
+}
@@ -0,0 +1,13 @@
+# The hc_am static library, shared by every project that links it so they all
+# build the same allocator.  Include it after the HSA include and link
+# directories are set.
+
+# libnuma is optional; without it the host backend relies on first-touch placement.
+find_library(NUMA_LIBRARY numa)
+
+add_library(hc_am STATIC ${CMAKE_CURRENT_LIST_DIR}/hc_am.cpp)
+target_link_libraries(hc_am hsa-runtime64 pthread)
+if (NUMA_LIBRARY)
+  set_property(TARGET hc_am APPEND PROPERTY COMPILE_DEFINITIONS AM_HAVE_LIBNUMA)
+  target_link_libraries(hc_am ${NUMA_LIBRARY})
+endif()
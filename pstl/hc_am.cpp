@@ -1,4 +1,19 @@
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <cstring>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef AM_HAVE_LIBNUMA
+#include <numa.h>
+#endif
 
 #include "hc_am.hpp"
 #include "hsa.h"
@@ -7,21 +22,563 @@ namespace am {
 struct memory_range {
     void *                  _base_pointer;
     size_t                  _size;
+    size_t                  _capacity;         // bytes actually allocated, _size rounded up if pooled
     hsa_agent_t             _hsa_agent;
     hsa_region_t            _hsa_region;
+    bool                    _is_host_memory;   // allocated by the host backend, not by HSA
+
+
+    memory_range(void *base_pointer, size_t size, size_t capacity, hsa_agent_t hsa_agent, hsa_region_t hsa_region) :
+       _base_pointer(base_pointer), _size(size), _capacity(capacity), _hsa_agent(hsa_agent), _hsa_region(hsa_region), _is_host_memory(false) {}; 
+    memory_range(void *base_pointer, size_t size, size_t capacity) :
+       _base_pointer(base_pointer), _size(size), _capacity(capacity), _is_host_memory(true) {}; 
+    memory_range() : _base_pointer(NULL), _size(0), _capacity(0), _is_host_memory(false) {};
+};
+
+//---
+// Pointer tracker.  Ranges are indexed by base pointer in a B+ tree whose nodes are
+// small sorted arrays, so a lookup is a binary search over a few contiguous cache
+// lines per level and also resolves pointers into the middle of an allocation.
+// Insert and erase are O(log n) whatever order the addresses come in.  Every key in
+// an inner node is the smallest base pointer under that child, so the range
+// containing ptr, if any, is always the last one at or below ptr on the descent.
+// Nodes that underflow are not merged, only empty ones are removed, so the height
+// is bounded by the largest number of live ranges ever tracked.
+// Lookups take a shared lock and may run concurrently from any number of host
+// threads; insert and erase take the exclusive lock.
+struct memory_tracker {
+    static const int FANOUT = 32;
+
+    struct node {
+        bool                        _leaf;
+        int                         _count;
+        const void *                _keys[FANOUT];      // smallest base pointer of each entry
+    };
+    struct leaf : node {
+        am::memory_range            _ranges[FANOUT];
+    };
+    struct inner : node {
+        node *                      _children[FANOUT];
+    };
+
+    node *                          _root;              // NULL when nothing is tracked
+    pthread_rwlock_t                _lock;
+
+    memory_tracker() : _root(NULL) { pthread_rwlock_init(&_lock, NULL); };
+    ~memory_tracker() { destroy(_root); pthread_rwlock_destroy(&_lock); };
+
+    memory_tracker(const memory_tracker &) = delete;
+    memory_tracker &operator=(const memory_tracker &) = delete;
+
+    // Last entry of n whose key is <= ptr, -1 if there is none.
+    static int slot(const node *n, const void *ptr) {
+        return int(std::upper_bound(n->_keys, n->_keys + n->_count, ptr) - n->_keys) - 1;
+    };
+
+    static void destroy(node *n) {
+        if (n == NULL) {
+            return;
+        }
+        if (n->_leaf) {
+            delete static_cast<leaf*>(n);
+        } else {
+            inner *in = static_cast<inner*>(n);
+            for (int i = 0; i < in->_count; i++) {
+                destroy(in->_children[i]);
+            }
+            delete in;
+        }
+    };
+
+    // Move the upper half of a full node to a new right sibling and return it.
+    static node *split(node *n) {
+        const int half = n->_count / 2;
+        node *right;
+        if (n->_leaf) {
+            leaf *l = static_cast<leaf*>(n);
+            leaf *r = new leaf;
+            std::copy(l->_ranges + half, l->_ranges + l->_count, r->_ranges);
+            right = r;
+        } else {
+            inner *in = static_cast<inner*>(n);
+            inner *r = new inner;
+            std::copy(in->_children + half, in->_children + in->_count, r->_children);
+            right = r;
+        }
+        right->_leaf = n->_leaf;
+        right->_count = n->_count - half;
+        std::copy(n->_keys + half, n->_keys + n->_count, right->_keys);
+        n->_count = half;
+        return right;
+    };
+
+    // Insert r below n, return the new right sibling if n had to be split.
+    static node *insert(node *n, const am::memory_range &r) {
+        const void *key = r._base_pointer;
+        int i = slot(n, key);
+        if (n->_leaf) {
+            leaf *l = static_cast<leaf*>(n);
+            i++;
+            std::copy_backward(l->_keys + i, l->_keys + l->_count, l->_keys + l->_count + 1);
+            std::copy_backward(l->_ranges + i, l->_ranges + l->_count, l->_ranges + l->_count + 1);
+            l->_keys[i] = key;
+            l->_ranges[i] = r;
+            l->_count++;
+        } else {
+            inner *in = static_cast<inner*>(n);
+            // a new smallest key goes to the first child
+            i = std::max(i, 0);
+            node *child = in->_children[i];
+            node *right = insert(child, r);
+            in->_keys[i] = child->_keys[0];
+            if (right != NULL) {
+                i++;
+                std::copy_backward(in->_keys + i, in->_keys + in->_count, in->_keys + in->_count + 1);
+                std::copy_backward(in->_children + i, in->_children + in->_count, in->_children + in->_count + 1);
+                in->_keys[i] = right->_keys[0];
+                in->_children[i] = right;
+                in->_count++;
+            }
+        }
+        return (n->_count == FANOUT) ? split(n) : NULL;
+    };
+
+    // Remove the entry with key base below n.  Empty children are unlinked and freed.
+    static bool erase(node *n, const void *base, am::memory_range *out) {
+        int i = slot(n, base);
+        if (i < 0) {
+            return false;
+        }
+        if (n->_leaf) {
+            leaf *l = static_cast<leaf*>(n);
+            if (l->_keys[i] != base) {
+                return false;
+            }
+            *out = l->_ranges[i];
+            std::copy(l->_keys + i + 1, l->_keys + l->_count, l->_keys + i);
+            std::copy(l->_ranges + i + 1, l->_ranges + l->_count, l->_ranges + i);
+            l->_count--;
+            return true;
+        }
+
+        inner *in = static_cast<inner*>(n);
+        node *child = in->_children[i];
+        if (!erase(child, base, out)) {
+            return false;
+        }
+        if (child->_count == 0) {
+            destroy(child);
+            std::copy(in->_keys + i + 1, in->_keys + in->_count, in->_keys + i);
+            std::copy(in->_children + i + 1, in->_children + in->_count, in->_children + i);
+            in->_count--;
+        } else {
+            in->_keys[i] = child->_keys[0];
+        }
+        return true;
+    };
+
+    void insert(const am::memory_range &r) {
+        pthread_rwlock_wrlock(&_lock);
+        if (_root == NULL) {
+            _root = new leaf;
+            _root->_leaf = true;
+            _root->_count = 0;
+        }
+        node *right = insert(_root, r);
+        if (right != NULL) {
+            inner *in = new inner;
+            in->_leaf = false;
+            in->_count = 2;
+            in->_keys[0] = _root->_keys[0];
+            in->_keys[1] = right->_keys[0];
+            in->_children[0] = _root;
+            in->_children[1] = right;
+            _root = in;
+        }
+        pthread_rwlock_unlock(&_lock);
+    };
+
+    // Remove the range starting exactly at base.  Interior pointers are not accepted.
+    bool erase(const void *base, am::memory_range *out) {
+        bool found = false;
+        pthread_rwlock_wrlock(&_lock);
+        if (_root != NULL) {
+            found = erase(_root, base, out);
+            if (_root->_count == 0) {
+                destroy(_root);
+                _root = NULL;
+            }
+            // drop inner roots with a single child
+            while (_root != NULL && !_root->_leaf && _root->_count == 1) {
+                inner *in = static_cast<inner*>(_root);
+                _root = in->_children[0];
+                delete in;
+            }
+        }
+        pthread_rwlock_unlock(&_lock);
+        return found;
+    };
+
+    // Find the range containing ptr, which may point anywhere inside the allocation.
+    bool find(const void *ptr, am::memory_range *out) {
+        bool found = false;
+        pthread_rwlock_rdlock(&_lock);
+        const node *n = _root;
+        while (n != NULL) {
+            int i = slot(n, ptr);
+            if (i < 0) {
+                break;
+            }
+            if (!n->_leaf) {
+                n = static_cast<const inner*>(n)->_children[i];
+                continue;
+            }
+            const am::memory_range &r = static_cast<const leaf*>(n)->_ranges[i];
+            if (static_cast<const char*>(ptr) < static_cast<const char*>(r._base_pointer) + r._size) {
+                *out = r;
+                found = true;
+            }
+            break;
+        }
+        pthread_rwlock_unlock(&_lock);
+        return found;
+    };
+};
+
+
+//---
+// Caching pool.  Freed blocks are kept on per-accelerator free lists, one list per
+// power-of-two size class, so a later am_alloc of the same class is a pop instead of
+// a trip through hsa_memory_allocate.  The total number of cached bytes is capped by
+// the high-water mark; blocks freed beyond it are released immediately.  Only requests
+// whose class fits under the high-water mark are rounded up to the class size, larger
+// ones could never be cached and are allocated at their exact size.
+#define AM_POOL_MIN_CLASS_SHIFT     8      // 256 bytes
+#define AM_POOL_MAX_CLASS_SHIFT     30     // 1 GiB, larger requests bypass the pool
+#define AM_POOL_NUM_CLASSES         (AM_POOL_MAX_CLASS_SHIFT - AM_POOL_MIN_CLASS_SHIFT + 1)
+#define AM_POOL_DEFAULT_HIGH_WATER  (size_t(256) << 20)
 
+struct pool {
+    std::vector<am::memory_range>   _free_list[AM_POOL_NUM_CLASSES];
+    size_t                          _cached_bytes;
 
-    memory_range(void *base_pointer, size_t size, hsa_agent_t hsa_agent, hsa_region_t hsa_region) :
-       _base_pointer(base_pointer), _size(size), _hsa_agent(hsa_agent), _hsa_region(hsa_region) {}; 
-    memory_range() : _base_pointer(NULL), _size(0) {};
+    pool() : _cached_bytes(0) {};
+};
+
+//---
+// Staging ring.  A few page-locked, HSA-registered host slices that large copies
+// between pageable host memory and accelerator memory are chunked through.  One
+// thread fills a slice while another drains the previous one, so the memcpy on the
+// host side overlaps with the transfer over the link.
+#define AM_STAGING_DEFAULT_SLICE_SIZE   (size_t(4) << 20)
+#define AM_STAGING_DEFAULT_NUM_SLICES   2
+#define AM_STAGING_MIN_COPY_SIZE        (size_t(1) << 20)   // smaller am_copy calls are not staged
+
+struct staging_ring {
+    std::mutex                      _lock;          // held for the duration of one staged copy
+    std::vector<char *>             _slices;
+    size_t                          _slice_size;
+    size_t                          _num_slices;
+
+    staging_ring() : _slice_size(AM_STAGING_DEFAULT_SLICE_SIZE), _num_slices(AM_STAGING_DEFAULT_NUM_SLICES) {};
 };
 
 struct context {
-    std::map<void *, am::memory_range> memory_tracker;
+    am::memory_tracker                  memory_tracker;
+    am::staging_ring                    staging;
+
+    std::mutex                          pool_lock;
+    std::map<uint64_t, am::pool>        pools;          // keyed by hsa agent handle, 0 for the host backend
+    size_t                              pool_high_water_mark;
+    am_pool_stats_t                     pool_stats;
+
+    context() : pool_high_water_mark(AM_POOL_DEFAULT_HIGH_WATER), pool_stats() {};
 };
 
 
 static am::context g_context;
+
+
+//---
+// Host backend, used when the accelerator is emulated (CPU accelerator).
+// Memory comes straight from mmap so it is always page aligned. Pages are
+// only backed on first touch, which places them on the NUMA node of the
+// thread that initializes the data.  If libnuma is available the pages are
+// bound to the node of the allocating thread instead.
+static void *host_allocate(size_t size)
+{
+    void *ptr = NULL;
+#ifdef AM_HAVE_LIBNUMA
+    if (numa_available() != -1) {
+        ptr = numa_alloc_local(size);
+        return ptr;
+    }
+#endif
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        ptr = NULL;
+    }
+    return ptr;
+}
+
+
+static void host_free(void *ptr, size_t size)
+{
+#ifdef AM_HAVE_LIBNUMA
+    if (numa_available() != -1) {
+        numa_free(ptr, size);
+        return;
+    }
+#endif
+    munmap(ptr, size);
+}
+
+
+// Return the size class index for a request, or -1 if it is too big to pool.
+static int size_class(size_t size)
+{
+    int shift = AM_POOL_MIN_CLASS_SHIFT;
+    while ((size_t(1) << shift) < size) {
+        shift++;
+        if (shift > AM_POOL_MAX_CLASS_SHIFT) {
+            return -1;
+        }
+    }
+    return shift - AM_POOL_MIN_CLASS_SHIFT;
+}
+
+
+static size_t class_bytes(int sc)
+{
+    return size_t(1) << (sc + AM_POOL_MIN_CLASS_SHIFT);
+}
+
+
+static uint64_t pool_key(const am::memory_range &r)
+{
+    return r._is_host_memory ? 0 : r._hsa_agent.handle;
+}
+
+
+// Bytes to allocate for a request: the class size if a block of that class can be
+// cached, the exact size otherwise.
+static size_t allocation_bytes(size_t size)
+{
+    int sc = size_class(size);
+    if (sc < 0) {
+        return size;
+    }
+    std::lock_guard<std::mutex> l(g_context.pool_lock);
+    return (class_bytes(sc) <= g_context.pool_high_water_mark) ? class_bytes(sc) : size;
+}
+
+
+// Hand the memory behind a range back to its backend.
+static void release(const am::memory_range &r)
+{
+    if (r._is_host_memory) {
+        host_free(r._base_pointer, r._capacity);
+    } else {
+        hsa_memory_free(r._base_pointer);
+    }
+}
+
+
+// Pop a cached block of the right class, return false on a miss.
+static bool pool_get(uint64_t key, size_t size, am::memory_range *r)
+{
+    int sc = size_class(size);
+    if (sc < 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> l(g_context.pool_lock);
+    am::pool &p = g_context.pools[key];
+    if (p._free_list[sc].empty()) {
+        g_context.pool_stats.misses++;
+        return false;
+    }
+
+    *r = p._free_list[sc].back();
+    p._free_list[sc].pop_back();
+    p._cached_bytes -= class_bytes(sc);
+    g_context.pool_stats.hits++;
+    g_context.pool_stats.cached_bytes -= class_bytes(sc);
+    r->_size = size;
+    return true;
+}
+
+
+// Try to cache a freed block, return false if the caller must release it.
+static bool pool_put(const am::memory_range &r)
+{
+    // blocks allocated at their exact size don't fit any class
+    int sc = size_class(r._size);
+    if ((sc < 0) || (r._capacity != class_bytes(sc))) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> l(g_context.pool_lock);
+    if (g_context.pool_stats.cached_bytes + class_bytes(sc) > g_context.pool_high_water_mark) {
+        g_context.pool_stats.releases++;
+        return false;
+    }
+
+    am::pool &p = g_context.pools[pool_key(r)];
+    p._free_list[sc].push_back(r);
+    p._cached_bytes += class_bytes(sc);
+    g_context.pool_stats.cached_bytes += class_bytes(sc);
+    return true;
+}
+
+
+// Release every cached block of one pool.  Caller holds pool_lock.
+static void pool_trim(am::pool &p)
+{
+    for (int sc = 0; sc < AM_POOL_NUM_CLASSES; sc++) {
+        for (auto &r : p._free_list[sc]) {
+            release(r);
+            g_context.pool_stats.releases++;
+        }
+        p._free_list[sc].clear();
+    }
+    g_context.pool_stats.cached_bytes -= p._cached_bytes;
+    p._cached_bytes = 0;
+}
+
+
+// Copy between two buffers.  HSA is only involved if one side is HSA memory.
+static hsa_status_t copy(void *dst, const void *src, size_t size)
+{
+    am::memory_range dstMR, srcMR;
+    bool dstHsa = g_context.memory_tracker.find(dst, &dstMR) && !dstMR._is_host_memory;
+    bool srcHsa = g_context.memory_tracker.find(src, &srcMR) && !srcMR._is_host_memory;
+
+    if (dstHsa || srcHsa) {
+        return hsa_memory_copy(dst, src, size);
+    } else {
+        memcpy(dst, src, size);
+        return HSA_STATUS_SUCCESS;
+    }
+}
+
+
+// Caller holds the ring lock.
+static void staging_release(am::staging_ring &ring)
+{
+    for (auto slice : ring._slices) {
+        hsa_memory_deregister(slice, ring._slice_size);
+        host_free(slice, ring._slice_size);
+    }
+    ring._slices.clear();
+}
+
+
+// Allocate, lock and register the ring slices.  Caller holds the ring lock.
+static bool staging_init(am::staging_ring &ring)
+{
+    if (!ring._slices.empty()) {
+        return true;
+    }
+    for (size_t i = 0; i < ring._num_slices; i++) {
+        char *slice = static_cast<char*>(host_allocate(ring._slice_size));
+        if (slice == NULL) {
+            // all or nothing, staged_copy() indexes every slice
+            staging_release(ring);
+            return false;
+        }
+        // Both are best effort: a slice that is neither locked nor registered still works,
+        // the runtime just has to stage it again internally.
+        mlock(slice, ring._slice_size);
+        hsa_memory_register(slice, ring._slice_size);
+        ring._slices.push_back(slice);
+    }
+    return true;
+}
+
+
+// Copy dst <- src through the ring.  The copy is split into slice sized chunks;
+// fill(slice, offset, bytes) loads a chunk into a slice and drain(slice, offset, bytes)
+// stores it to its destination.  Fill runs on the calling thread, drain on a helper
+// thread, with up to _num_slices chunks in flight between them.
+static hsa_status_t staged_copy(size_t size,
+                                std::function<hsa_status_t (char *, size_t, size_t)> fill,
+                                std::function<hsa_status_t (char *, size_t, size_t)> drain)
+{
+    am::staging_ring &ring = g_context.staging;
+    std::lock_guard<std::mutex> ring_lock(ring._lock);
+    if (!staging_init(ring)) {
+        return HSA_STATUS_ERROR;
+    }
+
+    const size_t num_chunks = (size + ring._slice_size - 1) / ring._slice_size;
+    size_t filled = 0;                  // chunks handed to the drain thread
+    size_t drained = 0;                 // chunks the drain thread has finished
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+    std::mutex m;
+    std::condition_variable cv;
+
+    std::thread drainer([&]() {
+        for (size_t c = 0; c < num_chunks; c++) {
+            {
+                std::unique_lock<std::mutex> l(m);
+                cv.wait(l, [&]() { return filled > c || status != HSA_STATUS_SUCCESS; });
+                if (status != HSA_STATUS_SUCCESS) {
+                    return;
+                }
+            }
+            size_t offset = c * ring._slice_size;
+            size_t bytes = std::min(ring._slice_size, size - offset);
+            hsa_status_t err = drain(ring._slices[c % ring._num_slices], offset, bytes);
+            {
+                std::lock_guard<std::mutex> l(m);
+                drained++;
+                if (err != HSA_STATUS_SUCCESS) {
+                    status = err;
+                }
+            }
+            cv.notify_all();
+        }
+    });
+
+    for (size_t c = 0; c < num_chunks; c++) {
+        {
+            // wait for the slice to come back from the drain thread
+            std::unique_lock<std::mutex> l(m);
+            cv.wait(l, [&]() { return c - drained < ring._num_slices || status != HSA_STATUS_SUCCESS; });
+            if (status != HSA_STATUS_SUCCESS) {
+                break;
+            }
+        }
+        size_t offset = c * ring._slice_size;
+        size_t bytes = std::min(ring._slice_size, size - offset);
+        hsa_status_t err = fill(ring._slices[c % ring._num_slices], offset, bytes);
+        {
+            std::lock_guard<std::mutex> l(m);
+            filled++;
+            if (err != HSA_STATUS_SUCCESS) {
+                status = err;
+            }
+        }
+        cv.notify_all();
+    }
+
+    drainer.join();
+    return status;
+}
+
+
+// Copy through the staging ring.  Each side is accessed with copy() so either side
+// can be HSA memory, host backend memory or plain pageable memory.
+static hsa_status_t staged_copy(void *dst, const void *src, size_t size)
+{
+    char *d = static_cast<char*>(dst);
+    const char *s = static_cast<const char*>(src);
+
+    return staged_copy(size,
+        [=](char *slice, size_t offset, size_t bytes) { return copy(slice, s + offset, bytes); },
+        [=](char *slice, size_t offset, size_t bytes) { return copy(d + offset, slice, bytes); });
+}
 }
 
 //#define TRACE
@@ -58,13 +615,22 @@ auto_voidp am_alloc(size_t size, unsigned flags, hc::accelerator_view av)
         hsa_agent_t *hsa_agent = static_cast<hsa_agent_t*> (av.get_hsa_agent());
         hsa_region_t *am_region = static_cast<hsa_region_t*>(av.get_hsa_am_region());
 
+        am::memory_range r;
+        if (am::pool_get(hsa_agent->handle, size, &r)) {
+            ptr = r._base_pointer;
+            am::g_context.memory_tracker.insert(r);
+            tprintf ("hc_am: tracking pooled %p sz=%zu\n", ptr, size);
+            return ptr;
+        }
+
         //TODO - how does AMP return errors?
 
 
         hsa_status_t s1 = HSA_STATUS_SUCCESS;
         hsa_status_t s2 = HSA_STATUS_SUCCESS;
 
-        s1 = hsa_memory_allocate(*am_region, size, &ptr);
+        size_t capacity = am::allocation_bytes(size);
+        s1 = hsa_memory_allocate(*am_region, capacity, &ptr);
         s2 = hsa_memory_assign_agent(ptr, *hsa_agent, HSA_ACCESS_PERMISSION_RW);
 
 
@@ -72,12 +638,28 @@ auto_voidp am_alloc(size_t size, unsigned flags, hc::accelerator_view av)
         if ((s1 != HSA_STATUS_SUCCESS) || (s2 != HSA_STATUS_SUCCESS)) {
             ptr = NULL;
         }
-        am::memory_range r(ptr, size, *hsa_agent, *am_region);
-        am::g_context.memory_tracker[ptr] = r;
-        tprintf ("hc_am: tracking %p sz=%zu\n", ptr, size);
+        if (ptr != NULL) {
+            r = am::memory_range(ptr, size, capacity, *hsa_agent, *am_region);
+            am::g_context.memory_tracker.insert(r);
+            tprintf ("hc_am: tracking %p sz=%zu\n", ptr, size);
+        }
 
     } else if (av.get_accelerator().get_is_emulated()) {
-        // TODO - handle host memory allocation here?
+        am::memory_range r;
+        if (am::pool_get(0, size, &r)) {
+            ptr = r._base_pointer;
+            am::g_context.memory_tracker.insert(r);
+            tprintf ("hc_am: tracking pooled host %p sz=%zu\n", ptr, size);
+            return ptr;
+        }
+
+        size_t capacity = am::allocation_bytes(size);
+        ptr = am::host_allocate(capacity);
+        if (ptr != NULL) {
+            r = am::memory_range(ptr, size, capacity);
+            am::g_context.memory_tracker.insert(r);
+            tprintf ("hc_am: tracking host %p sz=%zu\n", ptr, size);
+        }
     }
 
     return ptr;
@@ -87,15 +669,17 @@ auto_voidp am_alloc(size_t size, unsigned flags, hc::accelerator_view av)
 am_status_t am_free(void* ptr) 
 {
     if (ptr != NULL) {
-        hsa_memory_free(ptr);
-
-        size_t erased = am::g_context.memory_tracker.erase(ptr);
+        am::memory_range r;
 
         //TODO
-        if (erased == 0) {
+        if (!am::g_context.memory_tracker.erase(ptr, &r)) {
             tprintf ("hc_am: error - am_free can't find pointer=%p\n", ptr);
+            hsa_memory_free(ptr);
         } else {
             tprintf ("hc_am: freeing %p\n", ptr);
+            if (!am::pool_put(r)) {
+                am::release(r);
+            }
         }
         
     }
@@ -107,21 +691,53 @@ am_status_t am_free(void* ptr)
 // not assigned to a new accelerator cache.
 am_status_t am_copy(void*  dst, const void*  src, size_t size)
 {
-    auto destMR = am::g_context.memory_tracker.find(dst);
+    am::memory_range destMR, srcMR;
     hsa_status_t err;
 
-    if (destMR != am::g_context.memory_tracker.end()) {
+    bool dstTracked = am::g_context.memory_tracker.find(dst, &destMR);
+    bool srcTracked = am::g_context.memory_tracker.find(src, &srcMR);
+
+    if ((dstTracked != srcTracked) && (size >= AM_STAGING_MIN_COPY_SIZE) &&
+        !(dstTracked ? destMR : srcMR)._is_host_memory) {
+        // Large transfer between pageable host memory and the accelerator.
+        tprintf ("hc_am: staged copy dst: %p src: %p sz=%zu\n", dst, src, size);
+        err = am::staged_copy(dst, src, size);
+    } else if (dstTracked) {
         // Known pointer - use copy kernel?
         tprintf ("hc_am: copy_to tracked dst:  %p sz=%zu\n", dst, size);
         //
-        err = hsa_memory_copy(dst, src, size);
+        err = am::copy(dst, src, size);
     } else {
         // not found - must be host memory.
         tprintf ("hc_am: copy_to untracked  dst: %p sz=%zu\n", dst, size);
-        err = hsa_memory_copy(dst, src, size);
+        err = am::copy(dst, src, size);
     }
 
-    return AM_SUCCESS;// TODO.
+    return (err == HSA_STATUS_SUCCESS) ? AM_SUCCESS : AM_ERROR_MISC;
+}
+
+
+// Copy src->dst through the staging ring regardless of where either side lives.
+am_status_t am_copy_staged(void*  dst, const void*  src, size_t size)
+{
+    hsa_status_t err = am::staged_copy(dst, src, size);
+    return (err == HSA_STATUS_SUCCESS) ? AM_SUCCESS : AM_ERROR_MISC;
+}
+
+
+// Resize the staging ring.  The slices are reallocated on the next staged copy.
+am_status_t am_staging_configure(size_t slice_size, size_t num_slices)
+{
+    if ((slice_size == 0) || (num_slices == 0)) {
+        return AM_ERROR_MISC;
+    }
+
+    am::staging_ring &ring = am::g_context.staging;
+    std::lock_guard<std::mutex> l(ring._lock);
+    am::staging_release(ring);
+    ring._slice_size = slice_size;
+    ring._num_slices = num_slices;
+    return AM_SUCCESS;
 }
 
 
@@ -147,8 +763,127 @@ am_status_t am_copy(void*  dst, const void*  src, size_t size, hc::accelerator_v
         } else {
             am_status = AM_ERROR_MISC;
         }
+    } else if (dst_av.get_accelerator().get_is_emulated()) {
+        // CPU accelerator - both sides live in host memory.
+        memcpy(dst, src, size);
+        am_status = AM_SUCCESS;
     }
     return am_status;
 }
 
+
+// Queue a copy src->dst on av and return immediately.  *future becomes ready when
+// the copy is done.  If depends_on is given the copy does not start before it is
+// ready, which lets callers chain uploads, kernels and downloads without waiting
+// on the host.
+am_status_t am_copy_async(void*  dst, const void*  src, size_t size, hc::accelerator_view av,
+                          hc::completion_future *future, const hc::completion_future *depends_on)
+{
+    if ((dst == NULL) || (src == NULL) || (future == NULL)) {
+        return AM_ERROR_MISC;
+    }
+
+#ifdef HCC_VERSION_08
+    if (av.is_hsa_accelerator()) {
+#else
+    //TODO-kalmar - remove get_hsa_interop, this was old name for this function.
+    if (av.get_hsa_interop()) {
+#endif
+        // At least one side must be memory the agent can reach.
+        am::memory_range dstMR, srcMR;
+        bool dstTracked = am::g_context.memory_tracker.find(dst, &dstMR);
+        bool srcTracked = am::g_context.memory_tracker.find(src, &srcMR);
+        if (!dstTracked && !srcTracked) {
+            tprintf ("hc_am: copy_async with no tracked side dst=%p src=%p\n", dst, src);
+            return AM_ERROR_MISC;
+        }
+
+        try {
+            if (depends_on != NULL) {
+                av.create_blocking_marker(*const_cast<hc::completion_future*>(depends_on));
+            }
+            *future = av.copy_async(src, dst, size);
+        } catch (...) {
+            return AM_ERROR_MISC;
+        }
+        tprintf ("hc_am: copy_async dst=%p src=%p sz=%zu\n", dst, src, size);
+        return AM_SUCCESS;
+
+    } else if (av.get_accelerator().get_is_emulated()) {
+        // CPU accelerator - nothing to overlap with, copy now and hand back a ready marker.
+        if (depends_on != NULL) {
+            const_cast<hc::completion_future*>(depends_on)->wait();
+        }
+        memcpy(dst, src, size);
+        *future = av.create_marker();
+        return AM_SUCCESS;
+    }
+
+    return AM_ERROR_MISC;
+}
+
+
+// Look up the allocation containing ptr.  ptr may point anywhere inside it.
+am_status_t am_get_pointer_info(const void *ptr, am_pointer_info_t *info)
+{
+    am::memory_range r;
+    if (!am::g_context.memory_tracker.find(ptr, &r)) {
+        return AM_ERROR_MISC;
+    }
+    info->base_pointer   = r._base_pointer;
+    info->size           = r._size;
+    info->is_host_memory = r._is_host_memory;
+    return AM_SUCCESS;
+}
+
+
+// Release every cached block, for all accelerators.
+am_status_t am_pool_trim()
+{
+    std::lock_guard<std::mutex> l(am::g_context.pool_lock);
+    for (auto &p : am::g_context.pools) {
+        am::pool_trim(p.second);
+    }
+    return AM_SUCCESS;
+}
+
+
+// Release the cached blocks belonging to one accelerator_view.
+am_status_t am_pool_trim(hc::accelerator_view av)
+{
+    uint64_t key = 0;
+#ifdef HCC_VERSION_08
+    if (av.is_hsa_accelerator()) {
+#else
+    if (av.get_hsa_interop()) {
+#endif
+        key = static_cast<hsa_agent_t*> (av.get_hsa_agent())->handle;
+    }
+
+    std::lock_guard<std::mutex> l(am::g_context.pool_lock);
+    auto p = am::g_context.pools.find(key);
+    if (p != am::g_context.pools.end()) {
+        am::pool_trim(p->second);
+    }
+    return AM_SUCCESS;
+}
+
+
+// Set the maximum number of bytes kept in the pools.  Shrinking it does not
+// release anything by itself; call am_pool_trim for that.
+am_status_t am_pool_set_high_water_mark(size_t bytes)
+{
+    std::lock_guard<std::mutex> l(am::g_context.pool_lock);
+    am::g_context.pool_high_water_mark = bytes;
+    return AM_SUCCESS;
+}
+
+
+am_status_t am_pool_get_stats(am_pool_stats_t *stats)
+{
+    std::lock_guard<std::mutex> l(am::g_context.pool_lock);
+    *stats = am::g_context.pool_stats;
+    return AM_SUCCESS;
+}
+
 } // end namespace hc.
@@ -36,12 +36,38 @@ memory region using @ref am_copy or @ref am_update.
 */
 #define AM_EXPLICIT_SYNC (AM_DISABLE_AUTO_SYNC_IN | AM_DISABLE_AUTO_SYNC_OUT)
 
+/** Counters for the am_alloc caching pool. */
+typedef struct am_pool_stats {
+    size_t hits;            /** am_alloc served from a free list */
+    size_t misses;          /** am_alloc that had to go to the backend */
+    size_t releases;        /** blocks handed back to the backend */
+    size_t cached_bytes;    /** bytes currently held on free lists */
+} am_pool_stats_t;
+
+/** Describes the am_alloc allocation a pointer falls into. */
+typedef struct am_pointer_info {
+    void *  base_pointer;   /** pointer returned by am_alloc */
+    size_t  size;           /** size requested from am_alloc */
+    bool    is_host_memory; /** allocated by the host backend (CPU accelerator) */
+} am_pointer_info_t;
+
 namespace hc {
 
 auto_voidp am_alloc(size_t size, unsigned flags, hc::accelerator_view acc) ;
 am_status_t am_free(void*  ptr);
 am_status_t am_copy(void*  dst, const void*  src, size_t size);
 am_status_t am_copy(void*  dst, const void*  src, size_t size, hc::accelerator_view dst_acc);
+am_status_t am_copy_staged(void*  dst, const void*  src, size_t size);
+am_status_t am_staging_configure(size_t slice_size, size_t num_slices);
+am_status_t am_copy_async(void*  dst, const void*  src, size_t size, hc::accelerator_view acc,
+                          hc::completion_future *future, const hc::completion_future *depends_on = NULL);
+
+am_status_t am_get_pointer_info(const void *ptr, am_pointer_info_t *info);
+
+am_status_t am_pool_trim();
+am_status_t am_pool_trim(hc::accelerator_view acc);
+am_status_t am_pool_set_high_water_mark(size_t bytes);
+am_status_t am_pool_get_stats(am_pool_stats_t *stats);
 
 
 }; // namespace hc
@@ -0,0 +1,110 @@
+
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+// header file for the hc API
+#include <hc.hpp>
+#include "hc_am.hpp"
+
+// saxpy over a large input in batches.  Two sets of device buffers are used
+// in turn, so the upload of batch N+1 overlaps with the kernel on batch N.
+//
+// Uploads, kernels and downloads go to three accelerator_views of the same
+// accelerator.  Each view is in-order, so with a single copy view the upload of
+// batch N+1 would queue behind the download of batch N, which waits for kernel N.
+// The views are only ordered through completion_futures: a batch's kernel waits
+// for its two uploads, its download waits for the kernel, and the uploads into a
+// buffer set wait for the previous download from it.
+
+int main() {
+
+  constexpr int N = 1024 * 1024 * 64;
+  constexpr int BATCH = 1024 * 1024 * 4;
+  constexpr int NUM_BATCHES = N / BATCH;
+  constexpr float a = 100.0f;
+
+  std::vector<float> host_x(N);
+  std::vector<float> host_y(N);
+
+  // initialize the input data
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-N, N);
+  std::generate(host_x.begin(), host_x.end(), [&]() { return distribution(random_gen); });
+  std::generate(host_y.begin(), host_y.end(), [&]() { return distribution(random_gen); });
+
+  // CPU implementation of saxpy
+  std::vector<float> host_result_y(N);
+  for (int i = 0; i < N; i++) {
+    host_result_y[i] = a * host_x[i] + host_y[i];
+  }
+
+  hc::accelerator acc;
+  hc::accelerator_view upload_view = acc.create_view();
+  hc::accelerator_view compute_view = acc.create_view();
+  hc::accelerator_view download_view = acc.create_view();
+
+  // double buffered device memory
+  float* x[2];
+  float* y[2];
+  hc::completion_future download[2];
+  for (int b = 0; b < 2; b++) {
+    x[b] = hc::am_alloc(BATCH * sizeof(float), AM_EXPLICIT_SYNC, compute_view);
+    y[b] = hc::am_alloc(BATCH * sizeof(float), AM_EXPLICIT_SYNC, compute_view);
+  }
+
+  for (int batch = 0; batch < NUM_BATCHES; batch++) {
+    int b = batch % 2;
+    int offset = batch * BATCH;
+
+    // the buffers are free once the previous download from them is done,
+    // y[b] is the one that download reads
+    hc::completion_future* previous = (batch >= 2) ? &download[b] : NULL;
+
+    hc::completion_future upload_x, upload_y;
+    am_status_t s1 = hc::am_copy_async(x[b], host_x.data() + offset, BATCH * sizeof(float)
+                                       , upload_view, &upload_x, previous);
+    am_status_t s2 = hc::am_copy_async(y[b], host_y.data() + offset, BATCH * sizeof(float)
+                                       , upload_view, &upload_y, previous);
+    if (s1 != AM_SUCCESS || s2 != AM_SUCCESS) {
+      std::cout << "am_copy_async failed" << std::endl;
+      return 1;
+    }
+
+    float* bx = x[b];
+    float* by = y[b];
+    compute_view.create_blocking_marker({ upload_x, upload_y });
+    hc::completion_future kernel = hc::parallel_for_each(compute_view, hc::extent<1>(BATCH)
+                                                       , [=](hc::index<1> i) [[hc]] {
+      by[i[0]] = a * bx[i[0]] + by[i[0]];
+    });
+
+    am_status_t s3 = hc::am_copy_async(host_y.data() + offset, by, BATCH * sizeof(float)
+                                       , download_view, &download[b], &kernel);
+    if (s3 != AM_SUCCESS) {
+      std::cout << "am_copy_async failed" << std::endl;
+      return 1;
+    }
+  }
+
+  // only the last download of each buffer set needs to be waited on
+  download[0].wait();
+  download[1].wait();
+
+  for (int b = 0; b < 2; b++) {
+    hc::am_free(x[b]);
+    hc::am_free(y[b]);
+  }
+
+  // verify the results
+  int errors = 0;
+  for (int i = 0; i < N; i++) {
+    if (fabs(host_y[i] - host_result_y[i]) > fabs(host_result_y[i] * 0.0001f))
+      errors++;
+  }
+  std::cout << errors << " errors" << std::endl;
+
+  return errors;
+}
@@ -0,0 +1,96 @@
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include <chrono>
+
+// header file for the hc API
+#include <hc.hpp>
+#include "hc_am.hpp"
+#include "stream.hpp"
+
+// y = a * x + b over an input that is never held in memory as a whole.
+//
+//   saxpy_stream                 x is generated on the fly, 1G elements
+//   saxpy_stream input.bin       x is read from a file of raw floats
+//
+// Each chunk is checked on the host when it comes back.
+
+constexpr int CHUNK = 1024 * 1024 * 4;
+constexpr int DEPTH = 3;
+constexpr long long GENERATED = 1024LL * 1024 * 1024;
+
+int main(int argc, char* argv[]) {
+
+  constexpr float a = 100.0f;
+  constexpr float b = 3.0f;
+
+  FILE* input = NULL;
+  if (argc > 1) {
+    input = fopen(argv[1], "rb");
+    if (input == NULL) {
+      std::cout << "can't open " << argv[1] << std::endl;
+      return 1;
+    }
+  }
+
+  // one pipeline lane per HSA accelerator
+  std::vector<hc::accelerator_view> views;
+  std::vector<hc::accelerator> accelerators = hc::accelerator::get_all();
+  for (auto acc = accelerators.begin(); acc != accelerators.end(); acc++) {
+    if (acc->is_hsa_accelerator()) {
+      views.push_back(acc->create_view());
+    }
+  }
+  if (views.empty()) {
+    views.push_back(hc::accelerator().get_default_view());
+  }
+
+  long long generated = 0;
+  auto source = [&](float* x, int max) -> int {
+    if (input != NULL) {
+      return int(fread(x, sizeof(float), max, input));
+    }
+    int n = int(std::min<long long>(max, GENERATED - generated));
+    for (int i = 0; i < n; i++) {
+      x[i] = float((generated + i) % 2048) - 1024.0f;
+    }
+    generated += n;
+    return n;
+  };
+
+  auto kernel = [=](hc::accelerator_view& view, const float* x, float* y, int n) {
+    return hc::parallel_for_each(view, hc::extent<1>(n), [=](hc::index<1> i) [[hc]] {
+      y[i[0]] = a * x[i[0]] + b;
+    });
+  };
+
+  long long errors = 0;
+  auto sink = [&](const float* x, const float* y, long long offset, int n) {
+    for (int i = 0; i < n; i++) {
+      float expected = a * x[i] + b;
+      if (fabs(y[i] - expected) > fabs(expected * 0.0001f))
+        errors++;
+    }
+  };
+
+  stream::pipeline<float, float> pipeline(views, CHUNK, DEPTH);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  long long processed = pipeline.run(source, kernel, sink);
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  if (input != NULL) fclose(input);
+
+  if (processed < 0) {
+    std::cout << "pipeline failed" << std::endl;
+    return 1;
+  }
+  printf("%lld elements on %d views in %.3f s (%.2f GB/s in+out)\n", processed, int(views.size())
+         , seconds, 2.0 * processed * sizeof(float) / seconds / 1.0e9);
+  std::cout << errors << " errors" << std::endl;
+
+  return errors != 0;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <hc.hpp>
+#include "hc_am.hpp"
+
+// Streaming engine for inputs that do not fit in device memory.
+//
+//   stream::pipeline<float, float> p(views, CHUNK, 3);
+//   p.run(source, kernel, sink);
+//
+// The input is pulled in chunks of at most `chunk` elements:
+//
+//   int  source(In* host, int max)                 fill host[0, n), return n, 0 at the end
+//   hc::completion_future kernel(hc::accelerator_view& view, const In* in, Out* out, int n)
+//                                                  launch the kernel on device buffers
+//   void sink(const In* in, const Out* out, long long offset, int n)
+//                                                  consume a finished chunk
+//
+// Every accelerator_view gets `depth` slots, each with a host and a device buffer for
+// the input and the output, and its own accelerator_view on the same accelerator.
+// A slot's upload, kernel and download are ordered by its in-order view; different
+// slots' views run independently.  Chunks go to the slots round robin, so while one
+// slot's kernel runs, the next slot's upload and the previous slot's download are in
+// flight and the host is reading the chunk after that.  A slot is reused only after its
+// download finished and its chunk went to the sink, so chunks reach the sink in input
+// order and memory use stays at views * depth * chunk * (sizeof(In) + sizeof(Out)) on
+// each side, whatever the input size.
+
+namespace stream {
+
+template <typename In, typename Out>
+class pipeline {
+public:
+  pipeline(const std::vector<hc::accelerator_view>& views, int chunk, int depth = 3)
+    : _chunk(chunk) {
+    for (auto& view : views) {
+      for (int d = 0; d < depth; d++) {
+        _slots.emplace_back(view.get_accelerator().create_view(), chunk);
+      }
+    }
+  }
+
+  // the slots own device memory
+  pipeline(const pipeline&) = delete;
+  pipeline& operator=(const pipeline&) = delete;
+
+  // stream the whole input through kernel, returns the number of elements processed
+  // or -1 if a device allocation or copy failed
+  template <typename Source, typename Kernel, typename Sink>
+  long long run(Source source, Kernel kernel, Sink sink) {
+    for (auto& s : _slots) {
+      if (s.dev_in == NULL || s.dev_out == NULL) return -1;
+    }
+
+    long long offset = 0;
+    bool ok = true;
+    for (size_t next = 0; ok; next = (next + 1) % _slots.size()) {
+      slot& s = _slots[next];
+
+      // retire the chunk that used this slot last time around
+      ok = retire(s, sink);
+      if (!ok) break;
+
+      int n = source(s.host_in.data(), _chunk);
+      if (n <= 0) break;
+
+      ok = hc::am_copy_async(s.dev_in, s.host_in.data(), n * sizeof(In), s.view, &s.upload) == AM_SUCCESS;
+      if (!ok) break;
+
+      // the slot's view is in-order, the kernel starts after the upload and the
+      // download after the kernel
+      s.compute = kernel(s.view, static_cast<const In*>(s.dev_in), static_cast<Out*>(s.dev_out), n);
+
+      ok = hc::am_copy_async(s.host_out.data(), s.dev_out, n * sizeof(Out), s.view
+                             , &s.download) == AM_SUCCESS;
+      s.downloading = ok;
+      s.offset = offset;
+      s.count = n;
+      offset += n;
+    }
+
+    // drain the chunks still in flight, oldest first
+    size_t oldest = 0;
+    for (size_t i = 1; i < _slots.size(); i++) {
+      if (_slots[i].count > 0 && (_slots[oldest].count == 0 || _slots[i].offset < _slots[oldest].offset))
+        oldest = i;
+    }
+    for (size_t i = 0; i < _slots.size(); i++) {
+      ok = retire(_slots[(oldest + i) % _slots.size()], sink) && ok;
+    }
+
+    return ok ? offset : -1;
+  }
+
+private:
+  struct slot {
+    slot(const hc::accelerator_view& view, int chunk)
+      : view(view), host_in(chunk), host_out(chunk) {
+      dev_in = hc::am_alloc(chunk * sizeof(In), AM_EXPLICIT_SYNC, this->view);
+      dev_out = hc::am_alloc(chunk * sizeof(Out), AM_EXPLICIT_SYNC, this->view);
+    }
+
+    ~slot() {
+      hc::am_free(dev_in);
+      hc::am_free(dev_out);
+    }
+
+    slot(const slot&) = delete;
+    slot& operator=(const slot&) = delete;
+
+    hc::accelerator_view view;
+    std::vector<In> host_in;
+    std::vector<Out> host_out;
+    void* dev_in = NULL;
+    void* dev_out = NULL;
+    hc::completion_future upload;
+    hc::completion_future compute;
+    hc::completion_future download;
+    bool downloading = false;   // the download of the chunk in flight was queued
+    long long offset = 0;
+    int count = 0;        // elements in flight, 0 if the slot is free
+  };
+
+  // wait for everything queued for the slot's chunk and hand the chunk to the sink;
+  // false if a copy failed, the chunk is dropped then
+  template <typename Sink>
+  static bool retire(slot& s, Sink& sink) {
+    if (s.count == 0) return true;
+    bool ok = s.downloading;
+    try {
+      s.upload.wait();
+      s.compute.wait();
+      s.download.wait();
+    } catch (...) {
+      ok = false;
+    }
+    if (ok) sink(s.host_in.data(), s.host_out.data(), s.offset, s.count);
+    s.count = 0;
+    return ok;
+  }
+
+  int _chunk;
+  std::deque<slot> _slots;      // emplace_back never moves the slots
+};
+
+} // namespace stream
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <hc.hpp>
+#include "reduce.hpp"
+
+// Expression templates that fuse chains of elementwise operations, and optionally
+// a trailing reduction, into a single kernel.
+//
+//   fuse::view<float> x(av_x), y(av_y);
+//   y = a * x + y;                                         // one kernel
+//   float s = fuse::assign_sum(y, fuse::clamp(c * (a * x + y), lo, hi));
+//                                                          // y = ..., s = sum(y): one kernel
+//   float m = fuse::reduce<reduction::max<float>>(fuse::abs(x - y));
+//                                                          // nothing is stored
+//
+// Arithmetic on views, scalars and other expressions only builds a tree of small
+// structs; nothing runs until the tree is assigned or reduced.  The kernel then
+// evaluates the whole tree for element i in registers, so intermediate results never
+// go through memory.  All views in an expression must have the same extent.
+//
+// Element i may only depend on element i of each view, so a view can appear on both
+// sides of an assignment.  Reductions use the tile_static_tree strategy and the
+// two_pass combine from reduce.hpp, so results are reproducible run to run.
+
+namespace fuse {
+
+// tag base of every expression node
+template <typename E>
+struct expr {
+  const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename T>
+struct view : expr<view<T>> {
+  typedef T value_type;
+
+  view(const hc::array_view<T,1>& av) : av(av) {}
+
+  T operator()(int i) const [[cpu, hc]] { return av[i]; }
+  int size() const { return av.get_extent()[0]; }
+
+  template <typename E>
+  view& operator=(const expr<E>& e);
+
+  view& operator=(const view& v) { return *this = static_cast<const expr<view>&>(v); }
+
+  hc::array_view<T,1> av;
+};
+
+template <typename T>
+struct scalar : expr<scalar<T>> {
+  typedef T value_type;
+
+  scalar(T v) : v(v) {}
+
+  T operator()(int) const [[cpu, hc]] { return v; }
+  int size() const { return -1; }   // matches any extent
+
+  T v;
+};
+
+template <typename F, typename L, typename R>
+struct binary : expr<binary<F, L, R>> {
+  typedef decltype(F::apply(std::declval<typename L::value_type>()
+                            , std::declval<typename R::value_type>())) value_type;
+
+  binary(const L& l, const R& r) : l(l), r(r) {}
+
+  value_type operator()(int i) const [[cpu, hc]] { return F::apply(l(i), r(i)); }
+  int size() const { return l.size() >= 0 ? l.size() : r.size(); }
+
+  L l;
+  R r;
+};
+
+template <typename F, typename E>
+struct unary : expr<unary<F, E>> {
+  typedef decltype(std::declval<F>()(std::declval<typename E::value_type>())) value_type;
+
+  unary(const E& e, const F& f) : e(e), f(f) {}
+
+  value_type operator()(int i) const [[cpu, hc]] { return f(e(i)); }
+  int size() const { return e.size(); }
+
+  E e;
+  F f;
+};
+
+
+//---
+// Operators
+
+namespace detail {
+
+struct add { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a + b) { return a + b; } };
+struct sub { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a - b) { return a - b; } };
+struct mul { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a * b) { return a * b; } };
+struct div { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a / b) { return a / b; } };
+struct min { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a + b) { return (b < a) ? b : a; } };
+struct max { template <typename A, typename B> static auto apply(A a, B b) [[cpu, hc]] -> decltype(a + b) { return (a < b) ? b : a; } };
+
+template <typename T>
+struct clamp_to {
+  T operator()(T v) const [[cpu, hc]] { return (v < lo) ? lo : (hi < v) ? hi : v; }
+  T lo, hi;
+};
+
+template <typename T>
+struct absolute {
+  T operator()(T v) const [[cpu, hc]] { return (v < T(0)) ? -v : v; }
+};
+
+// wrap scalars so both sides of an operator are expressions
+template <typename E>
+const E& node(const expr<E>& e) { return e.self(); }
+
+template <typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+scalar<S> node(S s) { return scalar<S>(s); }
+
+template <typename A>
+using node_t = typename std::decay<decltype(node(std::declval<A>()))>::type;
+
+// an operator applies if at least one side is an expression and the other is an
+// expression or a scalar
+template <typename A, typename B>
+struct is_operand_pair {
+  template <typename X> static std::true_type is_expr(const expr<X>*);
+  static std::false_type is_expr(...);
+  template <typename X> struct check {
+    static constexpr bool e = decltype(is_expr(std::declval<X*>()))::value;
+    static constexpr bool ok = e || std::is_arithmetic<X>::value;
+  };
+  static constexpr bool value = check<A>::ok && check<B>::ok && (check<A>::e || check<B>::e);
+};
+
+template <typename F, typename A, typename B>
+using binary_t = typename std::enable_if<is_operand_pair<A, B>::value
+                                         , binary<F, node_t<A>, node_t<B>>>::type;
+
+} // namespace detail
+
+template <typename A, typename B>
+detail::binary_t<detail::add, A, B> operator+(const A& a, const B& b) {
+  return detail::binary_t<detail::add, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename A, typename B>
+detail::binary_t<detail::sub, A, B> operator-(const A& a, const B& b) {
+  return detail::binary_t<detail::sub, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename A, typename B>
+detail::binary_t<detail::mul, A, B> operator*(const A& a, const B& b) {
+  return detail::binary_t<detail::mul, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename A, typename B>
+detail::binary_t<detail::div, A, B> operator/(const A& a, const B& b) {
+  return detail::binary_t<detail::div, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename A, typename B>
+detail::binary_t<detail::min, A, B> min(const A& a, const B& b) {
+  return detail::binary_t<detail::min, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename A, typename B>
+detail::binary_t<detail::max, A, B> max(const A& a, const B& b) {
+  return detail::binary_t<detail::max, A, B>(detail::node(a), detail::node(b));
+}
+
+template <typename E, typename T>
+unary<detail::clamp_to<typename E::value_type>, E> clamp(const expr<E>& e, T lo, T hi) {
+  typedef typename E::value_type V;
+  return unary<detail::clamp_to<V>, E>(e.self(), detail::clamp_to<V>{ V(lo), V(hi) });
+}
+
+template <typename E>
+unary<detail::absolute<typename E::value_type>, E> abs(const expr<E>& e) {
+  return unary<detail::absolute<typename E::value_type>, E>(e.self(), detail::absolute<typename E::value_type>());
+}
+
+// any other elementwise function; f must be callable in [[hc]] code
+template <typename E, typename F>
+unary<F, E> map(const expr<E>& e, F f) {
+  return unary<F, E>(e.self(), f);
+}
+
+
+//---
+// Evaluation
+
+namespace detail {
+
+struct no_store {
+  template <typename V>
+  void operator()(int, V) const [[cpu, hc]] {}
+};
+
+template <typename T>
+struct store_to {
+  template <typename V>
+  void operator()(int i, V v) const [[cpu, hc]] { av[i] = v; }
+  hc::array_view<T,1> av;
+};
+
+// One kernel: each work-item evaluates elements gid and gid + numThreads, stores
+// them and reduces them; tiles are combined with reduction::two_pass.
+template <typename Op, int TileSize, typename E, typename Store>
+typename Op::value_type eval_reduce(const E& e, int num, Store store, Op op) {
+  typedef typename Op::value_type V;
+  typedef reduction::two_pass Combine;
+  typedef reduction::tile_static_tree Strategy;
+
+  if (num == 0) {
+    return Op::identity();
+  }
+
+  const int numTiles = reduction::load_pair::num_tiles<TileSize>(num);
+  const int numThreads = numTiles * TileSize;
+  const V identity = Op::identity();
+
+  hc::array_view<V,1> partials(Combine::num_partials(numTiles));
+  Combine::init(partials, identity);
+
+  hc::extent<1> globalExtent(numThreads);
+  hc::parallel_for_each(globalExtent.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+    int i0 = tidx.global[0];
+    int i1 = i0 + numThreads;
+    V v = identity;
+    if (i0 < num) {
+      auto x = e(i0);
+      store(i0, x);
+      v = op.load(x, i0);
+    }
+    if (i1 < num) {
+      auto x = e(i1);
+      store(i1, x);
+      v = op(v, op.load(x, i1));
+    }
+
+    V r = Strategy::template tile_reduce<TileSize>(v, tidx, op);
+    if (tidx.local[0] == 0) {
+      Combine::store(partials, tidx.tile[0], r, op);
+    }
+  });
+
+  return Combine::template finish<TileSize>(partials, numTiles, op, identity);
+}
+
+} // namespace detail
+
+// dst = e in one kernel
+template <typename T, typename E>
+hc::completion_future assign(const hc::array_view<T,1>& dst, const expr<E>& e) {
+  const E ex = e.self();
+  hc::array_view<T,1> av = dst;
+  return hc::parallel_for_each(av.get_extent(), [=](hc::index<1> i) [[hc]] {
+    av[i] = ex(i[0]);
+  });
+}
+
+// dst = e and return the reduction of the stored values, in one pass over memory
+template <typename Op, int TileSize = reduction::WAVEFRONT_SIZE, typename T, typename E>
+typename Op::value_type assign_reduce(const hc::array_view<T,1>& dst, const expr<E>& e, Op op = Op()) {
+  return detail::eval_reduce<Op, TileSize>(e.self(), dst.get_extent()[0], detail::store_to<T>{ dst }, op);
+}
+
+template <typename T, typename E>
+T assign_sum(const hc::array_view<T,1>& dst, const expr<E>& e) {
+  return assign_reduce<reduction::sum<T>>(dst, e);
+}
+
+// reduction of e without storing it anywhere
+template <typename Op, int TileSize = reduction::WAVEFRONT_SIZE, typename E>
+typename Op::value_type reduce(const expr<E>& e, Op op = Op()) {
+  return detail::eval_reduce<Op, TileSize>(e.self(), e.self().size(), detail::no_store(), op);
+}
+
+template <typename E>
+typename E::value_type sum(const expr<E>& e) {
+  return reduce<reduction::sum<typename E::value_type>>(e);
+}
+
+template <typename T>
+template <typename E>
+view<T>& view<T>::operator=(const expr<E>& e) {
+  assign(av, e);
+  return *this;
+}
+
+template <typename T, typename E>
+T assign_sum(view<T>& dst, const expr<E>& e) {
+  return assign_sum(dst.av, e);
+}
+
+template <typename T, typename E>
+hc::completion_future assign(view<T>& dst, const expr<E>& e) {
+  return assign(dst.av, e);
+}
+
+} // namespace fuse
@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <hc.hpp>
+#include "radix_sort.hpp"
+
+// Radix sort of 32 and 64-bit keys, with and without values, and a segmented sort
+// of many small arrays, checked against std::stable_sort and timed against std::sort.
+
+int errors = 0;
+
+void check(const char* name, bool ok) {
+  printf("%s: %s\n", name, ok ? "passed" : "failed");
+  if (!ok) errors++;
+}
+
+template <typename F>
+double time_ms(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count();
+}
+
+template <typename K, typename Gen>
+void check_keys(const char* name, int num, Gen gen) {
+  std::vector<K> keys(num);
+  std::generate(keys.begin(), keys.end(), gen);
+
+  std::vector<K> expected = keys;
+  double host_ms = time_ms([&]() { std::sort(expected.begin(), expected.end(), radix::less_host<K>); });
+
+  hc::array_view<K,1> av_keys(num, keys);
+  double gpu_ms = time_ms([&]() {
+    radix::sort(av_keys);
+    av_keys.synchronize();
+  });
+
+  // equal keys are indistinguishable, so any sort gives the same sequence
+  check(name, keys == expected);
+  printf("  %d keys: radix %.3f ms (%.1f Mkeys/s), std::sort %.3f ms\n", num, gpu_ms
+         , num / gpu_ms / 1.0e3, host_ms);
+}
+
+int main(int argc, char* argv[]) {
+
+  const int num = (argc > 1) ? atoi(argv[1]) : 1024 * 1024 * 16 + 17;
+
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<uint32_t> u32;
+  std::uniform_int_distribution<uint64_t> u64;
+  std::uniform_real_distribution<float> f32(-1.0e6f, 1.0e6f);
+  std::uniform_real_distribution<double> f64(-1.0e6, 1.0e6);
+
+  check_keys<uint32_t>("uint32", num, [&]() { return u32(random_gen); });
+  check_keys<int32_t>("int32", num, [&]() { return int32_t(u32(random_gen)); });
+  check_keys<float>("float", num, [&]() { return f32(random_gen); });
+  check_keys<uint64_t>("uint64", num, [&]() { return u64(random_gen); });
+  check_keys<int64_t>("int64", num, [&]() { return int64_t(u64(random_gen)); });
+  check_keys<double>("double", num, [&]() { return f64(random_gen); });
+
+  // key-value pairs: few distinct keys, so stability shows in the values
+  {
+    std::vector<int32_t> keys(num);
+    std::vector<int> values(num);
+    for (int i = 0; i < num; i++) {
+      keys[i] = int32_t(u32(random_gen) % 1000) - 500;
+      values[i] = i;
+    }
+
+    std::vector<int> expected(num);
+    for (int i = 0; i < num; i++) expected[i] = i;
+    std::stable_sort(expected.begin(), expected.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+
+    hc::array_view<int32_t,1> av_keys(num, keys);
+    hc::array_view<int,1> av_values(num, values);
+    radix::sort(av_keys, av_values);
+    av_values.synchronize();
+    check("int32 pairs (stable)", values == expected);
+  }
+
+  // segmented: many arrays of 0 to 3000 keys, a few longer than a tile
+  {
+    std::uniform_int_distribution<int> length(0, 3000);
+    std::vector<int> offsets(1, 0);
+    while (offsets.back() < num) {
+      offsets.push_back(std::min(num, offsets.back() + length(random_gen)));
+    }
+    const int numSegments = int(offsets.size()) - 1;
+
+    std::vector<float> keys(num);
+    std::vector<int> values(num);
+    for (int i = 0; i < num; i++) {
+      keys[i] = f32(random_gen);
+      values[i] = i;
+    }
+
+    const std::vector<float> original = keys;
+    std::vector<float> expected = keys;
+    double host_ms = time_ms([&]() {
+      for (int s = 0; s < numSegments; s++)
+        std::sort(expected.begin() + offsets[s], expected.begin() + offsets[s + 1]);
+    });
+
+    hc::array_view<float,1> av_keys(num, keys);
+    hc::array_view<int,1> av_values(num, values);
+    hc::array_view<const int,1> av_offsets(numSegments + 1, offsets);
+    double gpu_ms = time_ms([&]() {
+      radix::segmented_sort(av_keys, av_values, av_offsets);
+      av_keys.synchronize();
+      av_values.synchronize();
+    });
+
+    // every value still belongs to its key
+    bool pairs = true;
+    for (int i = 0; i < num; i++) pairs = pairs && (keys[i] == original[values[i]]);
+    check("segmented", keys == expected && pairs);
+    printf("  %d segments: radix %.3f ms, std::sort per segment %.3f ms\n", numSegments, gpu_ms, host_ms);
+  }
+
+  return errors;
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <type_traits>
+#include <hc.hpp>
+#include "reduce.hpp"
+#include "scan.hpp"
+#include "wave.hpp"
+
+// LSD radix sort, in place, ascending and stable.
+//
+//   radix::sort(av_keys);                          // int, unsigned, float, 64-bit variants
+//   radix::sort(av_keys, av_values);               // values move with their keys
+//   radix::segmented_sort(av_keys, av_offsets);    // segment s is [offsets[s], offsets[s + 1])
+//
+// Keys are sorted on their bits, RADIX_BITS at a time; signed and floating point
+// keys are first mapped to unsigned integers with the same order (negative floats
+// have all bits flipped, everything else only the sign bit), so -0.0 sorts before
+// 0.0 and NaNs sort to the ends.
+//
+// Each pass over a digit is three kernels over tiles of TileSize * Items keys:
+//   - count:   every tile counts its keys per digit; work-items count in registers,
+//              packed two 16-bit counters to a word, and the tile adds them up with
+//              reduction::tile_static_tree.  Counts go out digit-major.
+//   - scan:    scan::exclusive_scan of the counts gives, for every (digit, tile),
+//              where that tile's keys with that digit start in the output.
+//   - scatter: every tile ranks its keys by digit, stably, with a tile-wide scan of
+//              the packed counters (wave::inclusive_scan, then the wavefront
+//              totals), reorders them in tile_static memory and writes every digit's
+//              run out contiguously.
+// Passes alternate between the input and a scratch buffer; the number of passes is
+// even, so the result ends up back in the input.
+//
+// The kernels are instantiated for wave32 and wave64 and the default accelerator's
+// wavefront size picks one at run time.
+//
+// segmented_sort runs all passes of a segment inside one tile, with the keys kept in
+// tile_static memory, so a segment costs one read and one write.  Segments longer
+// than a tile are sorted one after the other with sort().
+
+namespace radix {
+
+constexpr int RADIX_BITS = 4;
+constexpr int RADIX = 1 << RADIX_BITS;
+
+//---
+// Keys as unsigned integers with the same order
+
+template <typename K>
+struct key_traits;
+
+template <>
+struct key_traits<uint32_t> {
+  typedef uint32_t bits_type;
+  static bits_type to_bits(uint32_t k) [[cpu, hc]] { return k; }
+};
+
+template <>
+struct key_traits<int32_t> {
+  typedef uint32_t bits_type;
+  static bits_type to_bits(int32_t k) [[cpu, hc]] { return uint32_t(k) ^ 0x80000000u; }
+};
+
+template <>
+struct key_traits<float> {
+  typedef uint32_t bits_type;
+  static bits_type to_bits(float k) [[cpu, hc]] {
+    union { float f; uint32_t u; } c;
+    c.f = k;
+    return c.u ^ ((c.u >> 31) ? 0xffffffffu : 0x80000000u);
+  }
+};
+
+template <>
+struct key_traits<uint64_t> {
+  typedef uint64_t bits_type;
+  static bits_type to_bits(uint64_t k) [[cpu, hc]] { return k; }
+};
+
+template <>
+struct key_traits<int64_t> {
+  typedef uint64_t bits_type;
+  static bits_type to_bits(int64_t k) [[cpu, hc]] { return uint64_t(k) ^ 0x8000000000000000ull; }
+};
+
+template <>
+struct key_traits<double> {
+  typedef uint64_t bits_type;
+  static bits_type to_bits(double k) [[cpu, hc]] {
+    union { double f; uint64_t u; } c;
+    c.f = k;
+    return c.u ^ ((c.u >> 63) ? 0xffffffffffffffffull : 0x8000000000000000ull);
+  }
+};
+
+namespace detail {
+
+// RADIX 16-bit counters, two to a word
+struct counters {
+  int word[RADIX / 2];
+
+  void clear() [[cpu, hc]] {
+    for (int w = 0; w < RADIX / 2; w++) word[w] = 0;
+  }
+  int get(int d) const [[cpu, hc]] { return (word[d / 2] >> (16 * (d % 2))) & 0xffff; }
+  void add(int d) [[cpu, hc]] { word[d / 2] += 1 << (16 * (d % 2)); }
+};
+
+// counters never carry from one half into the other, so the words add as a whole
+struct counters_sum {
+  counters operator()(counters a, counters b) const [[cpu, hc]] {
+    for (int w = 0; w < RADIX / 2; w++) a.word[w] += b.word[w];
+    return a;
+  }
+};
+
+template <typename K>
+int digit(K key, int shift) [[cpu, hc]] {
+  return int((key_traits<K>::to_bits(key) >> shift) & (RADIX - 1));
+}
+
+// Stable rank of every key of the tile by digit.
+//
+// Work-item l holds the keys at tile positions l * Items + k; padding keys past the
+// end of the data must have digit RADIX - 1 so they stay behind every real key.
+// On return rank[k] is where key k goes within the tile and start[d] is where the
+// keys with digit d start.
+template <int TileSize, int Items, int Width>
+void tile_rank(const int (&digits)[Items], int (&rank)[Items], int (&start)[RADIX]
+               , hc::tiled_index<1>& tidx) [[hc]] {
+  static_assert(TileSize * Items < 0x10000, "a tile's counts must fit 16 bits");
+  static_assert(TileSize % Width == 0, "a tile must be a whole number of wavefronts");
+  constexpr int WAVES = TileSize / Width;
+  tile_static counters s_waves[WAVES];
+
+  const int l = tidx.local[0];
+  const int lane = l % Width;
+  const int wave = l / Width;
+
+  // ranks among this work-item's own keys
+  counters c;
+  c.clear();
+  for (int k = 0; k < Items; k++) {
+    rank[k] = c.get(digits[k]);
+    c.add(digits[k]);
+  }
+
+  // keys with the same digit held by the work-items before this one
+  counters_sum op;
+  counters inclusive = wave::inclusive_scan<Width>(c, op);
+  if (lane == Width - 1) s_waves[wave] = inclusive;
+  tidx.barrier.wait();
+  if (l == 0) {
+    for (int w = 1; w < WAVES; w++) s_waves[w] = op(s_waves[w - 1], s_waves[w]);
+  }
+  tidx.barrier.wait();
+
+  counters before;
+  for (int w = 0; w < RADIX / 2; w++) before.word[w] = inclusive.word[w] - c.word[w];
+  if (wave > 0) before = op(s_waves[wave - 1], before);
+
+  const counters total = s_waves[WAVES - 1];
+  int s = 0;
+  for (int d = 0; d < RADIX; d++) {
+    start[d] = s;
+    s += total.get(d);
+  }
+  for (int k = 0; k < Items; k++) {
+    rank[k] += start[digits[k]] + before.get(digits[k]);
+  }
+  tidx.barrier.wait();
+}
+
+struct no_values {};
+
+template <typename K, typename V, int TileSize, int Items, int Width>
+struct sorter {
+  static constexpr int TILE_ELEMENTS = TileSize * Items;
+  static constexpr bool HAS_VALUES = !std::is_same<V, no_values>::value;
+
+  // counts[d * numTiles + tile] = keys in tile with digit d
+  static void count(const hc::array_view<const K,1>& keys, const hc::array_view<int,1>& counts
+                    , int num, int numTiles, int shift) {
+    counts.discard_data();
+    hc::extent<1> e(numTiles * TileSize);
+    hc::parallel_for_each(e.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+      const int tile = tidx.tile[0];
+      const int base = tile * TILE_ELEMENTS;
+      const int l = tidx.local[0];
+
+      // coalesced: work-item l reads keys l, l + TileSize, ...
+      counters c;
+      c.clear();
+      for (int k = 0; k < Items; k++) {
+        int i = base + k * TileSize + l;
+        if (i < num) c.add(digit(keys[i], shift));
+      }
+      counters total = reduction::tile_static_tree::tile_reduce<TileSize>(c, tidx, counters_sum());
+      if (l < RADIX) counts[l * numTiles + tile] = total.get(l);
+    });
+  }
+
+  // one stable pass from src to dst over the digit at shift
+  static void scatter(const hc::array_view<const K,1>& src_keys, const hc::array_view<K,1>& dst_keys
+                      , const hc::array_view<const V,1>& src_values, const hc::array_view<V,1>& dst_values
+                      , const hc::array_view<const int,1>& offsets, int num, int numTiles, int shift) {
+    hc::extent<1> e(numTiles * TileSize);
+    hc::parallel_for_each(e.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+      tile_static K s_keys[TILE_ELEMENTS];
+      tile_static V s_values[HAS_VALUES ? TILE_ELEMENTS : 1];
+
+      const int tile = tidx.tile[0];
+      const int base = tile * TILE_ELEMENTS;
+      const int l = tidx.local[0];
+      const int count = (num - base < TILE_ELEMENTS) ? num - base : TILE_ELEMENTS;
+
+      // work-item l holds the consecutive keys l * Items + k, which keeps the ranks stable
+      K key[Items];
+      int digits[Items];
+      for (int k = 0; k < Items; k++) {
+        int p = l * Items + k;
+        if (p < count) {
+          key[k] = src_keys[base + p];
+          digits[k] = digit(key[k], shift);
+        }
+        else {
+          digits[k] = RADIX - 1;
+        }
+      }
+
+      int rank[Items];
+      int start[RADIX];
+      tile_rank<TileSize, Items, Width>(digits, rank, start, tidx);
+
+      for (int k = 0; k < Items; k++) {
+        if (l * Items + k < count) {
+          s_keys[rank[k]] = key[k];
+          if (HAS_VALUES) s_values[rank[k]] = src_values[base + l * Items + k];
+        }
+      }
+      tidx.barrier.wait();
+
+      // every digit's keys are now consecutive in tile_static memory, write them out coalesced
+      for (int k = 0; k < Items; k++) {
+        int p = k * TileSize + l;
+        if (p < count) {
+          int d = digit(s_keys[p], shift);
+          int i = offsets[d * numTiles + tile] + p - start[d];
+          dst_keys[i] = s_keys[p];
+          if (HAS_VALUES) dst_values[i] = s_values[p];
+        }
+      }
+    });
+  }
+
+  static void run(const hc::array_view<K,1>& av_keys, const hc::array_view<V,1>& av_values) {
+    const int num = av_keys.get_extent()[0];
+    if (num < 2) return;
+
+    const int numTiles = (num + TILE_ELEMENTS - 1) / TILE_ELEMENTS;
+    const int passes = int(sizeof(typename key_traits<K>::bits_type)) * 8 / RADIX_BITS;
+    static_assert((sizeof(typename key_traits<K>::bits_type) * 8 / RADIX_BITS) % 2 == 0
+                  , "an even number of passes leaves the result in the input");
+
+    hc::array_view<K,1> av_tmp_keys(num);
+    hc::array_view<V,1> av_tmp_values(HAS_VALUES ? num : 1);
+    hc::array_view<int,1> av_counts(RADIX * numTiles);
+    hc::array_view<int,1> av_offsets(RADIX * numTiles);
+
+    hc::array_view<K,1> keys[2] = { av_keys, av_tmp_keys };
+    hc::array_view<V,1> values[2] = { av_values, av_tmp_values };
+    for (int pass = 0; pass < passes; pass++) {
+      const int from = pass % 2;
+      const int shift = pass * RADIX_BITS;
+      keys[1 - from].discard_data();
+      if (HAS_VALUES) values[1 - from].discard_data();
+
+      count(keys[from], av_counts, num, numTiles, shift);
+      scan::exclusive_scan<int>(av_counts, av_offsets, 0);
+      scatter(keys[from], keys[1 - from], values[from], values[1 - from], av_offsets, num, numTiles, shift);
+    }
+  }
+
+  // every tile sorts one segment of at most TILE_ELEMENTS keys, entirely in tile_static memory
+  static void run_segments(const hc::array_view<K,1>& av_keys, const hc::array_view<V,1>& av_values
+                           , const hc::array_view<const int,1>& av_offsets, int numSegments) {
+    constexpr int passes = int(sizeof(typename key_traits<K>::bits_type)) * 8 / RADIX_BITS;
+
+    hc::extent<1> e(numSegments * TileSize);
+    hc::parallel_for_each(e.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+      tile_static K s_keys[TILE_ELEMENTS];
+      tile_static V s_values[HAS_VALUES ? TILE_ELEMENTS : 1];
+
+      const int segment = tidx.tile[0];
+      const int base = av_offsets[segment];
+      const int count = av_offsets[segment + 1] - base;
+      const int l = tidx.local[0];
+      if (count < 2 || count > TILE_ELEMENTS) return;   // uniform across the tile
+
+      for (int k = 0; k < Items; k++) {
+        int p = k * TileSize + l;
+        if (p < count) {
+          s_keys[p] = av_keys[base + p];
+          if (HAS_VALUES) s_values[p] = av_values[base + p];
+        }
+      }
+      tidx.barrier.wait();
+
+      // padding stays behind the real keys in every pass, so positions >= count are never real
+      for (int pass = 0; pass < passes; pass++) {
+        const int shift = pass * RADIX_BITS;
+        K key[Items];
+        V value[HAS_VALUES ? Items : 1];
+        int digits[Items];
+        for (int k = 0; k < Items; k++) {
+          int p = l * Items + k;
+          if (p < count) {
+            key[k] = s_keys[p];
+            if (HAS_VALUES) value[k] = s_values[p];
+            digits[k] = digit(key[k], shift);
+          }
+          else {
+            digits[k] = RADIX - 1;
+          }
+        }
+
+        int rank[Items];
+        int start[RADIX];
+        tile_rank<TileSize, Items, Width>(digits, rank, start, tidx);
+
+        for (int k = 0; k < Items; k++) {
+          if (l * Items + k < count) {
+            s_keys[rank[k]] = key[k];
+            if (HAS_VALUES) s_values[rank[k]] = value[k];
+          }
+        }
+        tidx.barrier.wait();
+      }
+
+      for (int k = 0; k < Items; k++) {
+        int p = k * TileSize + l;
+        if (p < count) {
+          av_keys[base + p] = s_keys[p];
+          if (HAS_VALUES) av_values[base + p] = s_values[p];
+        }
+      }
+    });
+  }
+
+  static void segmented(const hc::array_view<K,1>& av_keys, const hc::array_view<V,1>& av_values
+                        , const hc::array_view<const int,1>& av_offsets) {
+    const int numSegments = av_offsets.get_extent()[0] - 1;
+    if (numSegments < 1) return;
+
+    run_segments(av_keys, av_values, av_offsets, numSegments);
+
+    // segments that don't fit a tile
+    for (int s = 0; s < numSegments; s++) {
+      int base = av_offsets[s];
+      int count = av_offsets[s + 1] - base;
+      if (count > TILE_ELEMENTS) {
+        run(av_keys.section(base, count), HAS_VALUES ? av_values.section(base, count) : av_values);
+      }
+    }
+  }
+};
+
+} // namespace detail
+
+// the order sort() produces, as a comparator for std::stable_sort
+template <typename K>
+bool less_host(K a, K b) {
+  return key_traits<K>::to_bits(a) < key_traits<K>::to_bits(b);
+}
+
+template <typename K, typename V, int TileSize = 256, int Items = 8>
+void sort(const hc::array_view<K,1>& av_keys, const hc::array_view<V,1>& av_values) {
+  wave::dispatch(hc::accelerator(), [&](auto width) {
+    detail::sorter<K, V, TileSize, Items, decltype(width)::value>::run(av_keys, av_values);
+  });
+}
+
+template <typename K, int TileSize = 256, int Items = 8>
+void sort(const hc::array_view<K,1>& av_keys) {
+  hc::array_view<detail::no_values,1> av_none(1);
+  sort<K, detail::no_values, TileSize, Items>(av_keys, av_none);
+}
+
+template <typename K, typename V, int TileSize = 256, int Items = 8>
+void segmented_sort(const hc::array_view<K,1>& av_keys, const hc::array_view<V,1>& av_values
+                    , const hc::array_view<const int,1>& av_offsets) {
+  wave::dispatch(hc::accelerator(), [&](auto width) {
+    detail::sorter<K, V, TileSize, Items, decltype(width)::value>::segmented(av_keys, av_values, av_offsets);
+  });
+}
+
+template <typename K, int TileSize = 256, int Items = 8>
+void segmented_sort(const hc::array_view<K,1>& av_keys, const hc::array_view<const int,1>& av_offsets) {
+  hc::array_view<detail::no_values,1> av_none(1);
+  segmented_sort<K, detail::no_values, TileSize, Items>(av_keys, av_none, av_offsets);
+}
+
+} // namespace radix
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <hc.hpp>
+#include "wave.hpp"
+
+#define __GROUP__ __attribute__((address_space(3)))
+
+// Generic tile reduction.
+//
+//   T result = reduction::reduce<T, Op, Strategy>(av);
+//
+// Each work-item loads and combines elements as selected by Load, each tile is
+// reduced to one partial with the selected strategy and the tile partials are then
+// combined as selected by Combine.
+//
+// Op is an associative operator with
+//   value_type                      - type being reduced, may differ from T (see argmax)
+//   static value_type identity()    - called on the host only
+//   value_type load(T x, int i)     - turns element i into a value_type
+//   value_type operator()(a, b)     - the combine
+// sum, min, max and argmax are provided, custom operators can derive from op_base.
+//
+// Strategy selects how a tile is reduced:
+//   tile_static_tree   - tree in tile_static memory
+//   dynamic_group_mem  - tree in the dynamic group segment
+//   shuffle            - hc::__shfl_down within a wavefront
+//   permute            - hc::__amdgcn_ds_permute within a wavefront
+//   bpermute           - hc::__amdgcn_ds_bpermute within a wavefront
+//   host               - sequential CPU reference, no kernel launched
+// The wavefront strategies require TileSize to be the accelerator's wavefront size.
+// The default TileSize, WAVEFRONT, is exactly that: reduce() is instantiated for
+// wave32 and wave64 and the default accelerator's width picks one at run time.
+//
+// Combine selects how the tile partials are merged:
+//   two_pass           - partials go to a buffer, a single tile folds them in a fixed
+//                        order; bit-reproducible run to run, including for float
+//   atomic             - every tile atomically combines its partial into one location;
+//                        sum over int/unsigned/float, min and max over int/unsigned
+//                        only, sum order is not deterministic
+//   host_combine       - partials are copied back and folded on the host in order
+//
+// Load selects how many elements a work-item reads:
+//   load_pair          - 2 elements per work-item, the grid grows with the input
+//   grid_stride        - the grid is a fixed number of tiles per compute unit and each
+//                        work-item strides over the input with 4-wide vector loads;
+//                        the array_view must start at the beginning of its buffer
+
+namespace reduction {
+
+// the widest wavefront
+constexpr int WAVEFRONT_SIZE = wave::WAVE_SIZE;
+
+// TileSize of one wavefront of the accelerator running the kernel, 32 or 64
+constexpr int WAVEFRONT = 0;
+
+
+//---
+// Operators
+
+template <typename T>
+struct op_base {
+  typedef T value_type;
+  value_type load(T x, int) const [[cpu, hc]] { return x; }
+};
+
+template <typename T>
+struct sum : op_base<T> {
+  static T identity() { return T(0); }
+  T operator()(T a, T b) const [[cpu, hc]] { return a + b; }
+};
+
+template <typename T>
+struct min : op_base<T> {
+  static T identity() { return std::numeric_limits<T>::max(); }
+  T operator()(T a, T b) const [[cpu, hc]] { return (b < a) ? b : a; }
+};
+
+template <typename T>
+struct max : op_base<T> {
+  static T identity() { return std::numeric_limits<T>::lowest(); }
+  T operator()(T a, T b) const [[cpu, hc]] { return (a < b) ? b : a; }
+};
+
+// value together with the index it came from
+template <typename T>
+struct arg_value {
+  T value;
+  int index;
+};
+
+// Largest element and its index, ties go to the lower index.
+template <typename T>
+struct argmax {
+  typedef arg_value<T> value_type;
+  static value_type identity() { return { std::numeric_limits<T>::lowest(), -1 }; }
+  value_type load(T x, int i) const [[cpu, hc]] { return { x, i }; }
+  value_type operator()(value_type a, value_type b) const [[cpu, hc]] {
+    if (a.index < 0) return b;
+    if (b.index < 0) return a;
+    if (a.value < b.value || (a.value == b.value && b.index < a.index)) return b;
+    return a;
+  }
+};
+
+
+//---
+// Wavefront data movement for any type made of 32-bit words.
+
+namespace detail {
+
+template <typename T>
+union words {
+  static_assert(sizeof(T) % sizeof(int) == 0, "wavefront strategies need a type made of 32-bit words");
+  T value;
+  int word[sizeof(T) / sizeof(int)];
+};
+
+// apply a 32-bit lane exchange to every word of v
+template <typename T, typename F>
+T exchange(T v, F f) [[hc]] {
+  words<T> u;
+  u.value = v;
+  for (int i = 0; i < int(sizeof(T) / sizeof(int)); i++) {
+    u.word[i] = f(u.word[i]);
+  }
+  return u.value;
+}
+
+} // namespace detail
+
+
+//---
+// Strategies
+
+struct tile_static_tree {
+  template <int TileSize>
+  static void prepare(hc::tiled_extent<1>&, size_t) {}
+
+  template <int TileSize, typename V, typename Op>
+  static V tile_reduce(V v, hc::tiled_index<1>& tidx, Op op) [[hc]] {
+    tile_static V partials[TileSize];
+    int localID = tidx.local[0];
+    partials[localID] = v;
+    tidx.barrier.wait_with_tile_static_memory_fence();
+
+    for (int w = TileSize / 2; w > 0; w /= 2) {
+      if (localID < w) {
+        partials[localID] = op(partials[localID], partials[localID + w]);
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+    }
+    return partials[0];
+  }
+};
+
+struct dynamic_group_mem {
+  template <int TileSize>
+  static void prepare(hc::tiled_extent<1>& e, size_t valueSize) {
+    e.set_dynamic_group_segment_size(TileSize * valueSize);
+  }
+
+  template <int TileSize, typename V, typename Op>
+  static V tile_reduce(V v, hc::tiled_index<1>& tidx, Op op) [[hc]] {
+    __GROUP__ V* partials = (__GROUP__ V*) hc::get_dynamic_group_segment_base_pointer();
+    int localID = tidx.local[0];
+    partials[localID] = v;
+    tidx.barrier.wait_with_tile_static_memory_fence();
+
+    for (int w = TileSize / 2; w > 0; w /= 2) {
+      if (localID < w) {
+        partials[localID] = op(partials[localID], partials[localID + w]);
+      }
+      tidx.barrier.wait_with_tile_static_memory_fence();
+    }
+    return partials[0];
+  }
+};
+
+struct shuffle {
+  template <int TileSize>
+  static void prepare(hc::tiled_extent<1>&, size_t) {}
+
+  template <int TileSize, typename V, typename Op>
+  static V tile_reduce(V v, hc::tiled_index<1>&, Op op) [[hc]] {
+    static_assert(TileSize == 32 || TileSize == 64, "shuffle reduces within a single wavefront");
+    for (int w = TileSize / 2; w > 0; w /= 2) {
+      v = op(v, detail::exchange(v, [=](int x) [[hc]] { return hc::__shfl_down(x, w, TileSize); }));
+    }
+    return v;
+  }
+};
+
+struct permute {
+  template <int TileSize>
+  static void prepare(hc::tiled_extent<1>&, size_t) {}
+
+  template <int TileSize, typename V, typename Op>
+  static V tile_reduce(V v, hc::tiled_index<1>& tidx, Op op) [[hc]] {
+    static_assert(TileSize == 32 || TileSize == 64, "permute reduces within a single wavefront");
+    int localID = tidx.local[0];
+    for (int w = TileSize / 2; w > 0; w /= 2) {
+      v = op(v, detail::exchange(v, [=](int x) [[hc]] {
+        return hc::__amdgcn_ds_permute((localID - w) << 2, x);
+      }));
+    }
+    return v;
+  }
+};
+
+struct bpermute {
+  template <int TileSize>
+  static void prepare(hc::tiled_extent<1>&, size_t) {}
+
+  template <int TileSize, typename V, typename Op>
+  static V tile_reduce(V v, hc::tiled_index<1>& tidx, Op op) [[hc]] {
+    static_assert(TileSize == 32 || TileSize == 64, "bpermute reduces within a single wavefront");
+    int localID = tidx.local[0];
+    for (int w = TileSize / 2; w > 0; w /= 2) {
+      v = op(v, detail::exchange(v, [=](int x) [[hc]] {
+        return hc::__amdgcn_ds_bpermute((localID + w) << 2, x);
+      }));
+    }
+    return v;
+  }
+};
+
+struct host {};
+
+
+//---
+// Load modes
+
+struct load_pair {
+  template <int TileSize>
+  static int num_tiles(int num) { return ((num + 1) / 2 + TileSize - 1) / TileSize; }
+
+  template <typename T, typename V, typename Op>
+  static V load(const hc::array_view<const T,1>& av_data, int gid, int numThreads, int num
+                , Op op, V identity) [[hc]] {
+    int i0 = gid;
+    int i1 = i0 + numThreads;
+    V v0 = (i0 < num) ? op.load(av_data[i0], i0) : identity;
+    V v1 = (i1 < num) ? op.load(av_data[i1], i1) : identity;
+    return op(v0, v1);
+  }
+};
+
+namespace detail {
+
+template <typename T>
+struct alignas(4 * sizeof(T)) vec4 {
+  T x[4];
+};
+
+} // namespace detail
+
+struct grid_stride {
+  static constexpr int TILES_PER_CU = 8;
+  static constexpr int MIN_ELEMENTS_PER_THREAD = 16;
+
+  // Enough tiles to fill the device, but no more than needed to give every
+  // work-item at least MIN_ELEMENTS_PER_THREAD elements.
+  template <int TileSize>
+  static int num_tiles(int num) {
+    int maxTiles = hc::accelerator().get_cu_count() * TILES_PER_CU;
+    int wantTiles = (num + TileSize * MIN_ELEMENTS_PER_THREAD - 1) / (TileSize * MIN_ELEMENTS_PER_THREAD);
+    return std::max(1, std::min(maxTiles, wantTiles));
+  }
+
+  template <typename T, typename V, typename Op>
+  static V load(const hc::array_view<const T,1>& av_data, int gid, int numThreads, int num
+                , Op op, V identity) [[hc]] {
+    const detail::vec4<T>* vdata = reinterpret_cast<const detail::vec4<T>*>(av_data.data());
+    const int numVec = num / 4;
+
+    V v = identity;
+    for (int q = gid; q < numVec; q += numThreads) {
+      detail::vec4<T> d = vdata[q];
+      V v01 = op(op.load(d.x[0], 4 * q), op.load(d.x[1], 4 * q + 1));
+      V v23 = op(op.load(d.x[2], 4 * q + 2), op.load(d.x[3], 4 * q + 3));
+      v = op(v, op(v01, v23));
+    }
+
+    // the last num % 4 elements
+    int i = numVec * 4 + gid;
+    if (i < num) {
+      v = op(v, op.load(av_data[i], i));
+    }
+    return v;
+  }
+};
+
+
+//---
+// Combine modes
+
+struct two_pass {
+  static int num_partials(int numTiles) { return numTiles; }
+
+  template <typename V>
+  static void init(hc::array_view<V,1>& partials, V) { partials.discard_data(); }
+
+  template <typename V, typename Op>
+  static void store(const hc::array_view<V,1>& partials, int tile, V r, Op) [[hc]] {
+    partials[tile] = r;
+  }
+
+  template <int TileSize, typename V, typename Op>
+  static V finish(const hc::array_view<V,1>& partials, int numTiles, Op op, V identity) {
+    hc::array_view<V,1> result(1);
+    result.discard_data();
+
+    // one tile: work-item l folds partials l, l+TileSize, l+2*TileSize, ... and the
+    // tile then reduces the TileSize values with a fixed tree
+    hc::extent<1> finalExtent(TileSize);
+    hc::parallel_for_each(finalExtent.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+      int localID = tidx.local[0];
+      V v = identity;
+      for (int t = localID; t < numTiles; t += TileSize) {
+        v = op(v, partials[t]);
+      }
+      V r = tile_static_tree::tile_reduce<TileSize>(v, tidx, op);
+      if (localID == 0) {
+        result[0] = r;
+      }
+    });
+    return result[0];
+  }
+};
+
+struct atomic {
+  static int num_partials(int) { return 1; }
+
+  template <typename V>
+  static void init(hc::array_view<V,1>& partials, V identity) { partials[0] = identity; }
+
+  template <typename V, typename Op>
+  static void store(const hc::array_view<V,1>& partials, int, V r, Op op) [[hc]] {
+    static_assert(std::is_same<Op, sum<V>>::value || std::is_same<Op, min<V>>::value
+                  || std::is_same<Op, max<V>>::value, "atomic combines sum, min and max only");
+    combine(&partials[0], r, op);
+  }
+
+  template <typename V>
+  static void combine(V* p, V r, sum<V>) [[hc]] { hc::atomic_fetch_add(p, r); }
+  template <typename V>
+  static void combine(V* p, V r, min<V>) [[hc]] { hc::atomic_fetch_min(p, r); }
+  template <typename V>
+  static void combine(V* p, V r, max<V>) [[hc]] { hc::atomic_fetch_max(p, r); }
+
+  template <int TileSize, typename V, typename Op>
+  static V finish(const hc::array_view<V,1>& partials, int, Op, V) {
+    return partials[0];
+  }
+};
+
+struct host_combine {
+  static int num_partials(int numTiles) { return numTiles; }
+
+  template <typename V>
+  static void init(hc::array_view<V,1>& partials, V) { partials.discard_data(); }
+
+  template <typename V, typename Op>
+  static void store(const hc::array_view<V,1>& partials, int tile, V r, Op) [[hc]] {
+    partials[tile] = r;
+  }
+
+  template <int TileSize, typename V, typename Op>
+  static V finish(const hc::array_view<V,1>& partials, int numTiles, Op op, V identity) {
+    V r = identity;
+    for (int t = 0; t < numTiles; t++) {
+      r = op(r, partials[t]);
+    }
+    return r;
+  }
+};
+
+
+//---
+// Entry points
+
+// CPU reference
+template <typename T, typename Op>
+typename Op::value_type reduce_host(const T* data, int num, Op op = Op()) {
+  typename Op::value_type r = Op::identity();
+  for (int i = 0; i < num; i++) {
+    r = op(r, op.load(data[i], i));
+  }
+  return r;
+}
+
+template <typename T, typename Op, typename Strategy, int TileSize, typename Combine, typename Load>
+struct reducer {
+  typedef typename Op::value_type V;
+
+  static V run(const hc::array_view<const T,1>& av_data, Op op) {
+    const int num = av_data.get_extent()[0];
+    if (num == 0) {
+      return Op::identity();
+    }
+
+    const int numTiles = Load::template num_tiles<TileSize>(num);
+    const int numThreads = numTiles * TileSize;
+    const V identity = Op::identity();
+
+    hc::array_view<V,1> partials(Combine::num_partials(numTiles));
+    Combine::init(partials, identity);
+
+    hc::extent<1> globalExtent(numThreads);
+    hc::tiled_extent<1> tiledExtent = globalExtent.tile(TileSize);
+    Strategy::template prepare<TileSize>(tiledExtent, sizeof(V));
+
+    hc::parallel_for_each(tiledExtent, [=](hc::tiled_index<1> tidx) [[hc]] {
+
+      // load values from global memory and calculate a partial result
+      V v = Load::load(av_data, tidx.global[0], numThreads, num, op, identity);
+
+      V r = Strategy::template tile_reduce<TileSize>(v, tidx, op);
+
+      if (tidx.local[0] == 0) {
+        Combine::store(partials, tidx.tile[0], r, op);
+      }
+    });
+
+    return Combine::template finish<TileSize>(partials, numTiles, op, identity);
+  }
+};
+
+template <typename T, typename Op, int TileSize, typename Combine, typename Load>
+struct reducer<T, Op, host, TileSize, Combine, Load> {
+  static typename Op::value_type run(const hc::array_view<const T,1>& av_data, Op op) {
+    const int num = av_data.get_extent()[0];
+    std::vector<T> data(num);
+    hc::copy(av_data, data.begin());
+    return reduce_host<T, Op>(data.data(), num, op);
+  }
+};
+
+namespace detail {
+
+// f(wave::width<TileSize>()), for WAVEFRONT the width of the default accelerator
+template <int TileSize>
+struct tile_size {
+  template <typename F>
+  static void dispatch(F f) { f(wave::width<TileSize>()); }
+};
+
+template <>
+struct tile_size<WAVEFRONT> {
+  template <typename F>
+  static void dispatch(F f) { wave::dispatch(hc::accelerator(), f); }
+};
+
+} // namespace detail
+
+template <typename T, typename Op = sum<T>, typename Strategy = tile_static_tree
+          , int TileSize = WAVEFRONT, typename Combine = two_pass, typename Load = load_pair>
+typename Op::value_type reduce(const hc::array_view<const T,1>& av_data, Op op = Op()) {
+  typename Op::value_type r;
+  detail::tile_size<TileSize>::dispatch([&](auto tile) {
+    r = reducer<T, Op, Strategy, decltype(tile)::value, Combine, Load>::run(av_data, op);
+  });
+  return r;
+}
+
+} // namespace reduction
@@ -3,13 +3,12 @@
 #include <random>
 #include <algorithm>
 #include <hc.hpp>
+#include "reduce.hpp"
+#include "autotune.hpp"
 
-#define __GROUP__ __attribute__((address_space(3)))
-
-void reduction(const int num, const int tileSize) {
+template <int TILE_SIZE>
+void reduction_test(const int num) {
   
-  int num_threads = num / 2;
-
   std::vector<int> data(num);
  
   // initialize the input data with random values
@@ -19,75 +18,56 @@ void reduction(const int num, const int tileSize) {
   auto gen = std::bind(distribution, random_gen);
   std::generate(data.begin(), data.end(), gen);
 
-  const hc::array_view<int,1> av_data(num, data);
-
-  // initialize the reduction sum to zero
-  hc::array_view<int,1> reduced(1);
-  reduced[0] = 0;
-
-  // define the grid size an the tile size
-  hc::extent<1> globalExtent(num_threads);
-  hc::tiled_extent<1> tiledExtent = globalExtent.tile(tileSize);
-  
-  tiledExtent.set_dynamic_group_segment_size(tileSize * sizeof(int));
-
-  hc::parallel_for_each(tiledExtent, [=](hc::tiled_index<1> tidx) [[hc]] {
+  const hc::array_view<const int,1> av_data(num, data);
 
-    // static allocation of group memory
-    __GROUP__ int* partialSums = (__GROUP__ int*) hc::get_dynamic_group_segment_base_pointer();
-    
-    // load 2 values from global memory and calculate a partial sum
-    int localSum = av_data(tidx.global) 
-                   + av_data(tidx.global[0] + globalExtent[0]);
-
-    // store the partial sum in local memory corresponding to the current thread
-    int localID = tidx.local[0];
-    partialSums[localID] = localSum;
-
-    // synchronize the local memory between threads in the same tile
-    tidx.barrier.wait_with_tile_static_memory_fence();
-
-    // With each iteration, reduce the number of threads participating in parallel reduction by
-    // half.  For the threads that are still active, load 2 values from the tile_static array
-    // and store the partial sum back to the static_static array
-    for (int w = tidx.tile_dim[0]/2; w > 1; w/=2) {
-
-      // check whether the current thread still participates in the reduction
-      if (localID < w) {
-        localSum = partialSums[localID]
-                   + partialSums[localID + w];
-
-        partialSums[localID] = localSum;
-      }
-
-      // synchronize the local memory between threads in the same tile
-      tidx.barrier.wait_with_tile_static_memory_fence();
-    }
-
-    // have thread #0 to combine the last 2 partial sums
-    // and to add it to the global reduction sum using an atomic add
-    if (localID == 0) {
-      localSum = partialSums[0] + partialSums[1];
-      hc::atomic_fetch_add(&reduced[0], localSum);
-    }
-  });
+  // reduce each tile with a tree in the dynamic group segment
+  int reduced = reduction::reduce<int, reduction::sum<int>
+                                  , reduction::dynamic_group_mem, TILE_SIZE>(av_data);
 
   // calculate the reduction on the CPU and verify the result
   int hostReduced = std::accumulate(data.begin(), data.end(), 0);
-  if (reduced[0] == hostReduced) {
+  if (reduced == hostReduced) {
     printf("passed\n");
   }
   else {
-    printf("failed, expected=%d, actual=%d\n", hostReduced, reduced[0]);
+    printf("failed, expected=%d, actual=%d\n", hostReduced, reduced);
   }
 }
 
 
+template <int TILE_SIZE>
+int reduce_with_tile(const hc::array_view<const int,1>& av_data) {
+  return reduction::reduce<int, reduction::sum<int>
+                           , reduction::dynamic_group_mem, TILE_SIZE>(av_data);
+}
+
+
 int main() {
   constexpr int NUM = 1024 * 1024;
-  for (int i = 64; i <= 512; i*=2) {
-    printf("tile size %d:",i);
-    reduction(NUM, i);
-  }
+  printf("tile size %d:", 64);
+  reduction_test<64>(NUM);
+  printf("tile size %d:", 128);
+  reduction_test<128>(NUM);
+  printf("tile size %d:", 256);
+  reduction_test<256>(NUM);
+  printf("tile size %d:", 512);
+  reduction_test<512>(NUM);
+
+  // pick the fastest tile size for this device and problem size, the
+  // choice is cached so later runs skip the measurement
+  std::vector<int> data(NUM, 1);
+  const hc::array_view<const int,1> av_data(NUM, data);
+  autotune::tuner tuner("reduce_dynamic_group_mem", hc::accelerator()
+                        , autotune::shape_bucket(NUM));
+  int best = tuner.select({64, 128, 256, 512}, [&](int tileSize) {
+    switch (tileSize) {
+      case 64:  reduce_with_tile<64>(av_data);  break;
+      case 128: reduce_with_tile<128>(av_data); break;
+      case 256: reduce_with_tile<256>(av_data); break;
+      case 512: reduce_with_tile<512>(av_data); break;
+    }
+  });
+  printf("best tile size: %d\n", best);
+
   return 0;
 }
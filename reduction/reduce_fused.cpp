@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <hc.hpp>
+#include "reduce.hpp"
+#include "fuse.hpp"
+
+// y = clamp(c * (a * x + y), lo, hi); s = sum(y)
+//
+// once as three elementwise kernels followed by a reduction, as written by hand,
+// and once as a single fused kernel.
+
+constexpr int ITERATIONS = 10;
+constexpr float a = 2.0f;
+constexpr float c = 0.5f;
+constexpr float lo = -0.75f;
+constexpr float hi = 0.75f;
+
+template <typename F>
+double time_ms(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    f();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count() / ITERATIONS;
+}
+
+int main(int argc, char* argv[]) {
+
+  const int num = (argc > 1) ? atoi(argv[1]) : 1024 * 1024 * 64;
+
+  std::vector<float> host_x(num);
+  std::vector<float> host_y(num);
+
+  // initialize the input data with random values
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::generate(host_x.begin(), host_x.end(), [&]() { return distribution(random_gen); });
+  std::generate(host_y.begin(), host_y.end(), [&]() { return distribution(random_gen); });
+
+  // CPU reference, in double to compare the sums with a tolerance
+  std::vector<float> host_result_y(num);
+  double host_s = 0.0;
+  for (int i = 0; i < num; i++) {
+    float v = c * (a * host_x[i] + host_y[i]);
+    host_result_y[i] = std::min(hi, std::max(lo, v));
+    host_s += host_result_y[i];
+  }
+
+  hc::array_view<const float,1> av_x(num, host_x);
+
+  // hand-written: every pass reads and writes y in memory
+  auto run_unfused = [&](const hc::array_view<float,1>& av_y) {
+    hc::parallel_for_each(av_y.get_extent(), [=](hc::index<1> i) [[hc]] {
+      av_y[i] = a * av_x[i] + av_y[i];
+    });
+    hc::parallel_for_each(av_y.get_extent(), [=](hc::index<1> i) [[hc]] {
+      av_y[i] = c * av_y[i];
+    });
+    hc::parallel_for_each(av_y.get_extent(), [=](hc::index<1> i) [[hc]] {
+      float v = av_y[i];
+      av_y[i] = (v < lo) ? lo : (hi < v) ? hi : v;
+    });
+    return reduction::reduce<float>(hc::array_view<const float,1>(av_y));
+  };
+
+  // fused: one kernel reads x and y once and writes y once
+  fuse::view<const float> x(av_x);
+  auto run_fused = [&](const hc::array_view<float,1>& av_y) {
+    fuse::view<float> y(av_y);
+    return fuse::assign_sum(y, fuse::clamp(c * (a * x + y), lo, hi));
+  };
+
+  // check both on the original data
+  std::vector<float> y_unfused(host_y);
+  std::vector<float> y_fused(host_y);
+  hc::array_view<float,1> av_y_unfused(num, y_unfused);
+  hc::array_view<float,1> av_y_fused(num, y_fused);
+  float s_unfused = run_unfused(av_y_unfused);
+  float s_fused = run_fused(av_y_fused);
+  av_y_unfused.synchronize();
+  av_y_fused.synchronize();
+
+  // time them on scratch copies, repeating the update in place
+  std::vector<float> scratch(host_y);
+  hc::array_view<float,1> av_scratch(num, scratch);
+  run_unfused(av_scratch);    // warm up, this also moves the data to the accelerator
+  double unfused = time_ms([&]() { run_unfused(av_scratch); });
+  double fused = time_ms([&]() { run_fused(av_scratch); });
+
+  int errors = 0;
+  for (int i = 0; i < num; i++) {
+    if (fabs(y_fused[i] - host_result_y[i]) > fabs(host_result_y[i] * 0.0001f)
+        || fabs(y_unfused[i] - host_result_y[i]) > fabs(host_result_y[i] * 0.0001f))
+      errors++;
+  }
+  bool sums_ok = std::fabs(host_s - s_fused) <= std::fabs(host_s * 0.001) + 1.0
+              && std::fabs(host_s - s_unfused) <= std::fabs(host_s * 0.001) + 1.0;
+
+  printf("%d elements: unfused %.3f ms, fused %.3f ms\n", num, unfused, fused);
+  printf("%s\n", (errors == 0 && sums_ok) ? "passed" : "failed");
+  return (errors == 0 && sums_ok) ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <hc.hpp>
+#include "reduce.hpp"
+
+// Compare 2-elements-per-thread loading against grid-stride loading.
+
+constexpr int ITERATIONS = 10;
+
+template <typename Load>
+double time_reduce(const hc::array_view<const int,1>& av_data, int* result) {
+  using namespace reduction;
+
+  // warm up, this also moves the data to the accelerator
+  *result = reduce<int, sum<int>, shuffle, WAVEFRONT, two_pass, Load>(av_data);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    *result = reduce<int, sum<int>, shuffle, WAVEFRONT, two_pass, Load>(av_data);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count() / ITERATIONS;
+}
+
+int main(int argc, char* argv[]) {
+
+  // largest problem size, 256M elements unless given on the command line
+  const int MAX_NUM = (argc > 1) ? atoi(argv[1]) : 1024 * 1024 * 256;
+
+  int errors = 0;
+  printf("%12s %14s %16s\n", "elements", "pair (ms)", "grid-stride (ms)");
+  for (long long n = 1000; n <= MAX_NUM; n *= 10) {
+    const int num = (int)n;
+
+    std::vector<int> data(num);
+
+    // initialize the input data with random values
+    constexpr int RAND_N = 100;
+    std::default_random_engine random_gen;
+    std::uniform_int_distribution<int> distribution(-RAND_N, RAND_N);
+    auto gen = std::bind(distribution, random_gen);
+    std::generate(data.begin(), data.end(), gen);
+
+    const hc::array_view<const int,1> av_data(num, data);
+
+    int pair_result, stride_result;
+    double pair_ms = time_reduce<reduction::load_pair>(av_data, &pair_result);
+    double stride_ms = time_reduce<reduction::grid_stride>(av_data, &stride_result);
+
+    int hostReduced = std::accumulate(data.begin(), data.end(), 0);
+    if (pair_result != hostReduced || stride_result != hostReduced) {
+      printf("failed, expected=%d, pair=%d, grid-stride=%d\n", hostReduced, pair_result, stride_result);
+      errors++;
+    }
+
+    printf("%12d %14.3f %16.3f\n", num, pair_ms, stride_ms);
+  }
+
+  return errors;
+}
@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <hc.hpp>
+#include "reduce.hpp"
+
+// a custom associative operator: sum of squares
+struct sum_squares : reduction::op_base<float> {
+  static float identity() { return 0.0f; }
+  float load(float x, int) const [[cpu, hc]] { return x * x; }
+  float operator()(float a, float b) const [[cpu, hc]] { return a + b; }
+};
+
+int errors = 0;
+
+template <typename T>
+void check(const char* name, T expected, T actual) {
+  if (expected == actual) {
+    printf("%s: passed\n", name);
+  }
+  else {
+    printf("%s: failed\n", name);
+    errors++;
+  }
+}
+
+int main() {
+
+  constexpr int NUM = 1024 * 1024 + 17;
+
+  std::vector<float> data(NUM);
+
+  // initialize the input data with random values
+  std::default_random_engine random_gen;
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::generate(data.begin(), data.end(), [&]() { return distribution(random_gen); });
+
+  const hc::array_view<const float,1> av_data(NUM, data);
+
+  using namespace reduction;
+
+  check("min", reduce_host<float, min<float>>(data.data(), NUM)
+             , reduce<float, min<float>, shuffle>(av_data));
+  check("max", reduce_host<float, max<float>>(data.data(), NUM)
+             , reduce<float, max<float>, bpermute>(av_data));
+
+  arg_value<float> expected = reduce_host<float, argmax<float>>(data.data(), NUM);
+  arg_value<float> actual = reduce<float, argmax<float>, permute>(av_data);
+  check("argmax", expected.index, actual.index);
+
+  // floating point sums depend on the combine order, compare against a
+  // double precision reference with a tolerance
+  double host_ss = 0.0;
+  for (float x : data)
+    host_ss += (double)x * x;
+  float gpu_ss = reduce<float, sum_squares, tile_static_tree>(av_data);
+  check("sum of squares", true, std::fabs(host_ss - gpu_ss) <= std::fabs(host_ss * 0.0001));
+
+  return errors;
+}
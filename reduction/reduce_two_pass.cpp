@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <hc.hpp>
+#include "reduce.hpp"
+
+// Compare the two-pass reduction against the atomic one on float data.
+// The two-pass result has to be bit-identical from run to run.
+
+constexpr int ITERATIONS = 10;
+
+template <typename Combine>
+double time_reduce(const hc::array_view<const float,1>& av_data, float* result) {
+  using namespace reduction;
+
+  // warm up, this also moves the data to the accelerator
+  *result = reduce<float, sum<float>, shuffle, WAVEFRONT, Combine>(av_data);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    *result = reduce<float, sum<float>, shuffle, WAVEFRONT, Combine>(av_data);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count() / ITERATIONS;
+}
+
+int main(int argc, char* argv[]) {
+
+  // largest problem size, 1G elements unless given on the command line
+  const int MAX_NUM = (argc > 1) ? atoi(argv[1]) : 1024 * 1024 * 1024;
+
+  int errors = 0;
+  printf("%12s %14s %14s %14s\n", "elements", "atomic (ms)", "two-pass (ms)", "reproducible");
+  for (long long n = 1024 * 1024; n <= MAX_NUM; n *= 4) {
+    const int num = (int)n;
+
+    std::vector<float> data(num);
+
+    // initialize the input data with random values
+    std::default_random_engine random_gen;
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::generate(data.begin(), data.end(), [&]() { return distribution(random_gen); });
+
+    const hc::array_view<const float,1> av_data(num, data);
+
+    float atomic_result, two_pass_result, again;
+    double atomic_ms = time_reduce<reduction::atomic>(av_data, &atomic_result);
+    double two_pass_ms = time_reduce<reduction::two_pass>(av_data, &two_pass_result);
+    time_reduce<reduction::two_pass>(av_data, &again);
+
+    bool reproducible = memcmp(&two_pass_result, &again, sizeof(float)) == 0;
+    if (!reproducible)
+      errors++;
+
+    printf("%12d %14.3f %14.3f %14s\n", num, atomic_ms, two_pass_ms, reproducible ? "yes" : "no");
+  }
+
+  return errors;
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <cmath>
+#include <hc.hpp>
+#include "reduce.hpp"
+#include "scan.hpp"
+
+// Inclusive and exclusive scans for int, float and double, checked against the
+// host reference, followed by a stream compaction built on the exclusive scan.
+
+// a custom associative operator: running bitwise or
+struct bit_or : reduction::op_base<int> {
+  static int identity() { return 0; }
+  int operator()(int a, int b) const [[cpu, hc]] { return a | b; }
+};
+
+int errors = 0;
+
+void check(const char* name, bool ok, const char* kind = "") {
+  printf("%s%s: %s\n", name, kind, ok ? "passed" : "failed");
+  if (!ok) errors++;
+}
+
+// float scans are reassociated, compare against a double reference with a tolerance
+bool close(const std::vector<double>& expected, const std::vector<float>& actual) {
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (std::fabs(expected[i] - actual[i]) > 1.0e-3 * (1.0 + std::fabs(expected[i])))
+      return false;
+  }
+  return true;
+}
+
+template <typename T, typename Op>
+void check_exact(const char* name, const std::vector<T>& data) {
+  const int num = data.size();
+  hc::array_view<const T,1> av_in(num, data);
+
+  std::vector<T> expected(num);
+  std::vector<T> actual(num);
+  hc::array_view<T,1> av_out(num, actual);
+
+  scan::inclusive_scan_host<T, Op>(data.data(), expected.data(), num);
+  scan::inclusive_scan<T, Op>(av_in, av_out);
+  av_out.synchronize();
+  check(name, expected == actual, " inclusive");
+
+  scan::exclusive_scan_host<T, Op>(data.data(), expected.data(), num, Op::identity());
+  scan::exclusive_scan<T, Op>(av_in, av_out, Op::identity());
+  av_out.synchronize();
+  check(name, expected == actual, " exclusive");
+}
+
+int main(int argc, char* argv[]) {
+
+  const int num = (argc > 1) ? atoi(argv[1]) : 1024 * 1024 * 16 + 17;
+
+  std::default_random_engine random_gen;
+  std::uniform_int_distribution<int> int_distribution(-100, 100);
+  std::uniform_real_distribution<float> float_distribution(-1.0f, 1.0f);
+
+  std::vector<int> host_int(num);
+  std::vector<float> host_float(num);
+  std::vector<double> host_double(num);
+  std::generate(host_int.begin(), host_int.end(), [&]() { return int_distribution(random_gen); });
+  std::generate(host_float.begin(), host_float.end(), [&]() { return float_distribution(random_gen); });
+  for (int i = 0; i < num; i++) {
+    // small integers, so double sums are exact in any order
+    host_double[i] = host_int[i];
+  }
+
+  using namespace reduction;
+
+  check_exact<int, sum<int>>("int sum", host_int);
+  check_exact<int, max<int>>("int max", host_int);
+  check_exact<int, bit_or>("int custom (or)", host_int);
+  check_exact<double, sum<double>>("double sum", host_double);
+  check_exact<double, min<double>>("double min", host_double);
+  check_exact<float, max<float>>("float max", host_float);
+
+  {
+    std::vector<double> expected(num);
+    double acc = 0.0;
+    for (int i = 0; i < num; i++) {
+      acc += host_float[i];
+      expected[i] = acc;
+    }
+    std::vector<float> actual(num);
+    hc::array_view<const float,1> av_in(num, host_float);
+    hc::array_view<float,1> av_out(num, actual);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    scan::inclusive_scan<float>(av_in, av_out);
+    av_out.synchronize();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+    check("float sum", close(expected, actual), " inclusive");
+    printf("inclusive scan of %d floats: %.3f ms\n", num, elapsed.count());
+  }
+
+  // stream compaction: keep the positive ints, in order
+  {
+    std::vector<int> flags(num);
+    for (int i = 0; i < num; i++) flags[i] = host_int[i] > 0;
+
+    std::vector<int> positions(num);
+    hc::array_view<const int,1> av_flags(num, flags);
+    hc::array_view<int,1> av_positions(num, positions);
+    scan::exclusive_scan<int>(av_flags, av_positions, 0);
+
+    const int kept = av_positions[num - 1] + flags[num - 1];
+    std::vector<int> compacted(std::max(kept, 1));
+    hc::array_view<const int,1> av_data(num, host_int);
+    hc::array_view<int,1> av_compacted(int(compacted.size()), compacted);
+    av_compacted.discard_data();
+    hc::parallel_for_each(av_data.get_extent(), [=](hc::index<1> i) [[hc]] {
+      if (av_data[i] > 0) av_compacted[av_positions[i]] = av_data[i];
+    });
+    av_compacted.synchronize();
+
+    std::vector<int> expected;
+    std::copy_if(host_int.begin(), host_int.end(), std::back_inserter(expected), [](int x) { return x > 0; });
+    compacted.resize(kept);
+    check("compaction", expected == compacted);
+  }
+
+  return errors;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <hc.hpp>
+#include "reduce.hpp"
+#include "wave.hpp"
+
+// Single-pass prefix scan with decoupled look-back.
+//
+//   scan::inclusive_scan<float>(av_in, av_out);
+//   scan::exclusive_scan<int, reduction::max<int>>(av_in, av_out, init);
+//
+// Op is any reduction:: operator whose value_type is T (sum, min, max or a custom
+// one derived from op_base); it must be associative, identity() is only used to pad
+// the last tile.
+//
+// Every tile scans TileSize * Items consecutive elements:
+//   - each work-item scans its Items elements sequentially in registers,
+//   - the work-item totals are scanned within each wavefront with
+//     wave::inclusive_scan and the wavefront totals through tile_static memory,
+//   - the tile publishes its aggregate, then walks back over the tiles before it,
+//     adding their aggregates until it finds one that already published its
+//     inclusive prefix, and publishes its own inclusive prefix,
+//   - every element gets the tile prefix added and is written out.
+// Input and output are each touched once.  Tiles take their position from an atomic
+// counter in the order they start, so every tile a look-back waits on has already
+// started and will finish.  aggregate[] and prefix[] are plain stores and loads, so a
+// release fence comes before each status publish and an acquire fence after each
+// status observed; without them a tile can see the status and still read a stale
+// value out of its CU's L1.  The kernel is instantiated for wave32 and wave64 and the
+// default accelerator's wavefront size picks one at run time.
+
+namespace scan {
+
+// tile status
+constexpr int STATUS_NONE = 0;        // nothing published yet
+constexpr int STATUS_AGGREGATE = 1;   // aggregate[tile] holds the tile's own total
+constexpr int STATUS_PREFIX = 2;      // prefix[tile] holds everything up to the tile's end
+
+namespace detail {
+
+template <typename T, typename Op, int TileSize, int Items, bool Exclusive, int Width>
+void scan(const hc::array_view<const T,1>& av_in, const hc::array_view<T,1>& av_out, T init, Op op) {
+  static_assert(TileSize % Width == 0, "a tile must be a whole number of wavefronts");
+  constexpr int WAVES = TileSize / Width;
+  constexpr int TILE_ELEMENTS = TileSize * Items;
+
+  const int num = av_in.get_extent()[0];
+  if (num == 0) return;
+
+  const int numTiles = (num + TILE_ELEMENTS - 1) / TILE_ELEMENTS;
+  const T identity = Op::identity();
+
+  // status[0] is the tile counter, status[1 + t] the status of tile t
+  std::vector<int> zeros(numTiles + 1, 0);
+  hc::array_view<int,1> av_status(numTiles + 1, zeros);
+  hc::array_view<T,1> av_aggregate(numTiles);
+  hc::array_view<T,1> av_prefix(numTiles);
+  av_aggregate.discard_data();
+  av_prefix.discard_data();
+  av_out.discard_data();
+
+  hc::extent<1> e(numTiles * TileSize);
+  hc::parallel_for_each(e.tile(TileSize), [=](hc::tiled_index<1> tidx) [[hc]] {
+    tile_static int s_tile;
+    tile_static T s_waves[WAVES];
+    tile_static T s_prefix;
+
+    const int l = tidx.local[0];
+    const int lane = l % Width;
+    const int wave = l / Width;
+
+    // position in scan order
+    if (l == 0) s_tile = hc::atomic_fetch_add(&av_status[0], 1);
+    tidx.barrier.wait();
+    const int tile = s_tile;
+    const int base = tile * TILE_ELEMENTS + l * Items;
+
+    // 1. this work-item's elements
+    T items[Items];
+    T acc = identity;
+    for (int k = 0; k < Items; k++) {
+      T x = (base + k < num) ? av_in[base + k] : identity;
+      acc = op(acc, x);
+      items[k] = acc;
+    }
+
+    // 2. work-item totals across the tile
+    T inclusive = wave::inclusive_scan<Width>(acc, op);
+    if (lane == Width - 1) s_waves[wave] = inclusive;
+    tidx.barrier.wait();
+    if (l == 0) {
+      for (int w = 1; w < WAVES; w++) s_waves[w] = op(s_waves[w - 1], s_waves[w]);
+    }
+    tidx.barrier.wait();
+    if (wave > 0) inclusive = op(s_waves[wave - 1], inclusive);
+    T exclusive = wave::move<wave::up_lanes<1, Width>>(inclusive);
+    if (lane == 0) exclusive = (wave > 0) ? s_waves[wave - 1] : identity;
+    const T aggregate = s_waves[WAVES - 1];
+
+    // 3. publish and look back
+    if (l == 0) {
+      T prefix = identity;
+      if (tile == 0) {
+        av_prefix[0] = aggregate;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        hc::atomic_exchange(&av_status[1], STATUS_PREFIX);
+      }
+      else {
+        av_aggregate[tile] = aggregate;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        hc::atomic_exchange(&av_status[1 + tile], STATUS_AGGREGATE);
+
+        for (int t = tile - 1; t >= 0; ) {
+          int status = hc::atomic_fetch_add(&av_status[1 + t], 0);
+          if (status != STATUS_NONE) __atomic_thread_fence(__ATOMIC_ACQUIRE);
+          if (status == STATUS_PREFIX) {
+            prefix = op(av_prefix[t], prefix);
+            break;
+          }
+          if (status == STATUS_AGGREGATE) {
+            prefix = op(av_aggregate[t], prefix);
+            t--;
+          }
+          // STATUS_NONE: tile t has started but not published yet, ask again
+        }
+        av_prefix[tile] = op(prefix, aggregate);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        hc::atomic_exchange(&av_status[1 + tile], STATUS_PREFIX);
+      }
+      s_prefix = prefix;
+    }
+    tidx.barrier.wait();
+
+    // 4. write out
+    T before = op(s_prefix, exclusive);
+    if (Exclusive) before = op(init, before);
+    for (int k = 0; k < Items; k++) {
+      if (base + k < num) {
+        if (Exclusive) {
+          av_out[base + k] = (k == 0) ? before : op(before, items[k - 1]);
+        }
+        else {
+          av_out[base + k] = op(before, items[k]);
+        }
+      }
+    }
+  });
+}
+
+} // namespace detail
+
+// CPU reference
+template <typename T, typename Op>
+void inclusive_scan_host(const T* in, T* out, int num, Op op = Op()) {
+  T acc = Op::identity();
+  for (int i = 0; i < num; i++) {
+    acc = op(acc, in[i]);
+    out[i] = acc;
+  }
+}
+
+template <typename T, typename Op>
+void exclusive_scan_host(const T* in, T* out, int num, T init, Op op = Op()) {
+  T acc = init;
+  for (int i = 0; i < num; i++) {
+    T x = in[i];
+    out[i] = acc;
+    acc = op(acc, x);
+  }
+}
+
+template <typename T, typename Op = reduction::sum<T>, int TileSize = 256, int Items = 8>
+void inclusive_scan(const hc::array_view<const T,1>& av_in, const hc::array_view<T,1>& av_out, Op op = Op()) {
+  wave::dispatch(hc::accelerator(), [&](auto width) {
+    detail::scan<T, Op, TileSize, Items, false, decltype(width)::value>(av_in, av_out, Op::identity(), op);
+  });
+}
+
+// out[i] = init op in[0] op ... op in[i - 1]
+template <typename T, typename Op = reduction::sum<T>, int TileSize = 256, int Items = 8>
+void exclusive_scan(const hc::array_view<const T,1>& av_in, const hc::array_view<T,1>& av_out
+                    , T init, Op op = Op()) {
+  wave::dispatch(hc::accelerator(), [&](auto width) {
+    detail::scan<T, Op, TileSize, Items, true, decltype(width)::value>(av_in, av_out, init, op);
+  });
+}
+
+} // namespace scan
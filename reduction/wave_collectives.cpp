@@ -0,0 +1,210 @@
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <hc.hpp>
+#include "wave.hpp"
+
+// Checks the wavefront collectives of wave.hpp.
+//
+// The host emulation is compared with a plain sequential reference for every
+// collective, for types of 4, 6, 8 and 12 bytes and for 64 and 32-wide wavefronts.
+// With an HSA accelerator the same collectives then run in a kernel built for the
+// accelerator's wavefront size and are compared with the emulation.
+
+// 6 bytes, not a whole number of 32-bit words
+struct short3 {
+  short x, y, z;
+  bool operator==(const short3& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct vec3 {
+  float x, y, z;
+  bool operator==(const vec3& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct add {
+  int operator()(int a, int b) const [[cpu, hc]] { return a + b; }
+  double operator()(double a, double b) const [[cpu, hc]] { return a + b; }
+  short3 operator()(short3 a, short3 b) const [[cpu, hc]] {
+    return { short(a.x + b.x), short(a.y + b.y), short(a.z + b.z) };
+  }
+  vec3 operator()(vec3 a, vec3 b) const [[cpu, hc]] { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+};
+
+int errors = 0;
+
+void check(const char* name, bool ok) {
+  printf("%s: %s\n", name, ok ? "passed" : "failed");
+  if (!ok) errors++;
+}
+
+template <typename T, int Width>
+bool same(const T (&a)[Width], const T (&b)[Width]) {
+  for (int l = 0; l < Width; l++) {
+    if (!(a[l] == b[l])) return false;
+  }
+  return true;
+}
+
+template <typename T, int Width>
+void copy(const T (&from)[Width], T (&to)[Width]) {
+  for (int l = 0; l < Width; l++) to[l] = from[l];
+}
+
+constexpr int ROTATE = 5;
+
+// a source lane in the upper half of the wavefront
+template <int Width>
+constexpr int source() { return Width / 2 + 5; }
+
+// odd lanes set
+template <int Width>
+constexpr uint64_t odd_mask() { return 0xaaaaaaaaaaaaaaaaull >> (64 - Width); }
+
+// emulation against the sequential definition
+template <typename T, int Width>
+void check_emulated(const char* name, const T (&input)[Width]) {
+  printf("%s, emulated wave%d\n", name, Width);
+  constexpr int SOURCE = source<Width>();
+  add op;
+  T lanes[Width];
+  T expected[Width];
+
+  copy(input, lanes);
+  wave::emulated::reduce(lanes, op);
+  T total = input[0];
+  for (int l = 1; l < Width; l++) total = op(total, input[l]);
+  for (int l = 0; l < Width; l++) expected[l] = total;
+  check("  reduce", same(lanes, expected));
+
+  copy(input, lanes);
+  wave::emulated::inclusive_scan(lanes, op);
+  expected[0] = input[0];
+  for (int l = 1; l < Width; l++) expected[l] = op(expected[l - 1], input[l]);
+  check("  inclusive_scan", same(lanes, expected));
+
+  copy(input, lanes);
+  wave::emulated::broadcast(lanes, SOURCE);
+  for (int l = 0; l < Width; l++) expected[l] = input[SOURCE];
+  check("  broadcast", same(lanes, expected));
+
+  copy(input, lanes);
+  wave::emulated::rotate<ROTATE>(lanes);
+  for (int l = 0; l < Width; l++) expected[l] = input[(l + ROTATE) % Width];
+  bool ok = same(lanes, expected);
+  wave::emulated::rotate<-ROTATE>(lanes);
+  check("  rotate", ok && same(lanes, input));
+}
+
+// the device against the emulation, for one wavefront
+template <typename T, int Width>
+void check_device(const char* name, const T (&input)[Width]) {
+  printf("%s, device wave%d\n", name, Width);
+  constexpr int SOURCE = source<Width>();
+  add op;
+  std::vector<T> host_in(input, input + Width);
+  std::vector<T> host_out(Width * 4);
+  hc::array_view<const T,1> av_in(Width, host_in);
+  hc::array_view<T,1> av_out(Width * 4, host_out);
+  av_out.discard_data();
+
+  hc::extent<1> e(Width);
+  hc::parallel_for_each(e.tile(Width), [=](hc::tiled_index<1> tidx) [[hc]] {
+    const int l = tidx.local[0];
+    T v = av_in[l];
+    av_out[l] = wave::reduce<Width>(v, op);
+    av_out[Width + l] = wave::inclusive_scan<Width>(v, op);
+    av_out[2 * Width + l] = wave::broadcast<Width>(v, SOURCE);
+    av_out[3 * Width + l] = wave::rotate<ROTATE, Width>(v);
+  });
+  av_out.synchronize();
+
+  const char* names[] = { "  reduce", "  inclusive_scan", "  broadcast", "  rotate" };
+  for (int c = 0; c < 4; c++) {
+    T lanes[Width];
+    T actual[Width];
+    copy(input, lanes);
+    switch (c) {
+      case 0: wave::emulated::reduce(lanes, op); break;
+      case 1: wave::emulated::inclusive_scan(lanes, op); break;
+      case 2: wave::emulated::broadcast(lanes, SOURCE); break;
+      default: wave::emulated::rotate<ROTATE>(lanes); break;
+    }
+    for (int l = 0; l < Width; l++) actual[l] = host_out[c * Width + l];
+    check(names[c], same(lanes, actual));
+  }
+}
+
+template <int Width>
+void check_votes(bool device) {
+  printf("ballot/any/all, %s wave%d\n", device ? "device" : "emulated", Width);
+  bool none[Width], odd[Width], every[Width];
+  for (int l = 0; l < Width; l++) {
+    none[l] = false;
+    odd[l] = l % 2;
+    every[l] = true;
+  }
+
+  if (!device) {
+    check("  ballot", wave::emulated::ballot(odd) == odd_mask<Width>());
+    check("  any", !wave::emulated::any(none) && wave::emulated::any(odd));
+    check("  all", !wave::emulated::all(odd) && wave::emulated::all(every));
+    return;
+  }
+
+  hc::array_view<uint64_t,1> av_result(5);
+  av_result.discard_data();
+  hc::extent<1> e(Width);
+  hc::parallel_for_each(e.tile(Width), [=](hc::tiled_index<1> tidx) [[hc]] {
+    const int l = tidx.local[0];
+    uint64_t b = wave::ballot(l % 2);
+    bool anyNone = wave::any(false);
+    bool anyOdd = wave::any(l % 2);
+    bool allOdd = wave::all(l % 2);
+    bool allEvery = wave::all(true);
+    if (l == 0) {
+      av_result[0] = b;
+      av_result[1] = anyNone;
+      av_result[2] = anyOdd;
+      av_result[3] = allOdd;
+      av_result[4] = allEvery;
+    }
+  });
+  check("  ballot", av_result[0] == odd_mask<Width>());
+  check("  any", !av_result[1] && av_result[2]);
+  check("  all", !av_result[3] && av_result[4]);
+}
+
+template <typename T, typename F>
+void check_type(const char* name, bool device, F make) {
+  T input[wave::WAVE_SIZE];
+  for (int l = 0; l < wave::WAVE_SIZE; l++) input[l] = make(l);
+  check_emulated(name, input);
+  check_emulated(name, reinterpret_cast<const T (&)[32]>(input));
+  if (device) {
+    wave::dispatch(hc::accelerator(), [&](auto width) {
+      constexpr int W = decltype(width)::value;
+      check_device(name, reinterpret_cast<const T (&)[W]>(input));
+    });
+  }
+}
+
+int main() {
+
+  const bool device = hc::accelerator().is_hsa_accelerator();
+  if (device) printf("wavefront size: %d\n", wave::size());
+
+  // small integer valued inputs keep float and double sums exact in any order
+  check_type<int>("int", device, [](int l) { return l * 7 - 100; });
+  check_type<short3>("short3 (6 bytes)", device, [](int l) { return short3{ short(l), short(-l), short(l * 3) }; });
+  check_type<double>("double", device, [](int l) { return double(l) * 0.5 - 3.0; });
+  check_type<vec3>("vec3 (12 bytes)", device, [](int l) { return vec3{ float(l), float(2 * l), float(-l) }; });
+
+  check_votes<64>(false);
+  check_votes<32>(false);
+  if (device) {
+    wave::dispatch(hc::accelerator(), [](auto width) { check_votes<decltype(width)::value>(true); });
+  }
+
+  return errors;
+}